@@ -1,12 +1,12 @@
 #include "CameraComponent.hpp"
 #include <glm/glm.hpp>
 
-Mat4 CameraComponent::get_view_matrix(Vec3 position, Vec3 forward, Vec3 up) {
+Mat4 CameraComponent::get_view_matrix(Vec3 position, Vec3 forward, Vec3 up) const {
     Vec3 target = position + forward;
     return glm::lookAt(position, target, up);
 }
 
-Mat4 CameraComponent::get_projection_matrix() {
+Mat4 CameraComponent::get_projection_matrix() const {
     if (projection_type == ProjectionType::Perspective) {
         return glm::perspective(
             glm::radians(this->fov_degrees),
@@ -1,12 +1,12 @@
 #ifndef GAME_CAMERACOMPONENT_H
 #define GAME_CAMERACOMPONENT_H
 
-#include <interfaces/IComponent.h>
 #include <bgfx/bgfx.h>
 #include <core/Types.h>
+#include <core/Relocatable.h>
 
 
-class CameraComponent : public IComponent {
+class CameraComponent {
 public:
     bgfx::ViewId view_id = 0;
     uint16_t clear_flags = BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH;
@@ -21,8 +21,10 @@ public:
     // --- Orthographic Properties ---
     float ortho_size = 10.0f;
 
-    Mat4 get_view_matrix(Vec3 position, Vec3 forward, Vec3 up);
-    Mat4 get_projection_matrix();
+    Mat4 get_view_matrix(Vec3 position, Vec3 forward, Vec3 up) const;
+    Mat4 get_projection_matrix() const;
 };
 
+static_assert(is_trivially_relocatable_v<CameraComponent>, "CameraComponent must stay trivially relocatable");
+
 #endif //GAME_CAMERACOMPONENT_H
\ No newline at end of file
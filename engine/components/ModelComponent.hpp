@@ -2,17 +2,19 @@
 #define GAME_MODELCOMPONENT_H
 
 #include <memory>
-#include <interfaces/IComponent.h>
+#include <core/Relocatable.h>
 
 class MeshData;
 class Material;
 
-class ModelComponent : public IComponent {
+class ModelComponent {
 public:
     std::shared_ptr<MeshData> mesh;
     std::shared_ptr<Material> material;
 };
 
-
+// shared_ptr holds no pointer to itself, so moving its bytes is a valid move
+template<>
+struct is_trivially_relocatable<ModelComponent> : std::true_type {};
 
 #endif //GAME_MODELCOMPONENT_H
\ No newline at end of file
@@ -2,11 +2,10 @@
 #define GAME_RIGIDBODYCOMPONENT_HPP
 
 #include <core/Types.h>
-#include <interfaces/IComponent.h>
 #include <Jolt/Jolt.h>
 #include <Jolt/Physics/Body/BodyID.h>
 
-class RigidBodyComponent : public IComponent {
+class RigidBodyComponent {
 public:
     BodyType type = BodyType::Static;
     float mass = 1.0f;
@@ -1,133 +1,309 @@
 #include "TransformComponent.hpp"
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define GAME_TRANSFORM_SSE
+#endif
+
+// ======================== TransformStreams ===================== //
+void TransformStreams::append(size_t count) {
+    reserve(m_size + count);
+
+    size_t first = m_size;
+    m_size += count;
+    for (auto& stream : m_fields) {
+        stream.resize((m_size + 3) / 4);
+    }
+    m_local_position.resize(m_size);
+    m_local_rotation.resize(m_size);
+    m_local_scale.resize(m_size);
+    m_matrices.resize(m_size);
+    m_dirty.resize(m_size);
+
+    for (size_t slot = first; slot < m_size; slot++) {
+        reset(slot);
+    }
+}
+
+void TransformStreams::reset(size_t slot) {
+    TransformRef transform(*this, slot);
+    transform.set_position(Vec3(0.0f, 0.0f, 0.0f));
+    transform.set_rotation(Quat(1.0f, 0.0f, 0.0f, 0.0f));
+    transform.set_scale(Vec3(1.0f, 1.0f, 1.0f));
+    m_local_position[slot] = Vec3(0.0f, 0.0f, 0.0f);
+    m_local_rotation[slot] = Quat(1.0f, 0.0f, 0.0f, 0.0f);
+    m_local_scale[slot] = Vec3(1.0f, 1.0f, 1.0f);
+}
+
+void TransformStreams::swap(size_t a, size_t b) {
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        std::swap(field(Field(f), a), field(Field(f), b));
+    }
+    std::swap(m_local_position[a], m_local_position[b]);
+    std::swap(m_local_rotation[a], m_local_rotation[b]);
+    std::swap(m_local_scale[a], m_local_scale[b]);
+    std::swap(m_matrices[a], m_matrices[b]);
+    std::swap(m_dirty[a], m_dirty[b]);
+}
+
+void TransformStreams::swap_remove(size_t slot) {
+    size_t last = m_size - 1;
+    if (slot != last) {
+        move_slot(last, slot);
+    }
+
+    --m_size;
+    for (auto& stream : m_fields) {
+        stream.resize((m_size + 3) / 4);
+    }
+    m_local_position.pop_back();
+    m_local_rotation.pop_back();
+    m_local_scale.pop_back();
+    m_matrices.pop_back();
+    m_dirty.pop_back();
+}
 
-TransformComponent::TransformComponent() {
-    set_position(Vec3(0.0f, 0.0f, 0.0f));
-    set_rotation(Quat(1.0f, 0.0f, 0.0f, 0.0f));
-    set_scale(Vec3(1.0f, 1.0f, 1.0f));
+void TransformStreams::reserve(size_t capacity) {
+    for (auto& stream : m_fields) {
+        stream.reserve((capacity + 3) / 4);
+    }
+    m_local_position.reserve(capacity);
+    m_local_rotation.reserve(capacity);
+    m_local_scale.reserve(capacity);
+    m_matrices.reserve(capacity);
+    m_dirty.reserve(capacity);
 }
 
-TransformComponent::TransformComponent(const Vec3 &position) {
-    set_local_position(position);
-    set_local_rotation(Quat(1.0f, 0.0f, 0.0f, 0.0f));
-    set_local_scale(Vec3(1.0f, 1.0f, 1.0f));
+void TransformStreams::move_slot(size_t from, size_t to) {
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        field(Field(f), to) = field(Field(f), from);
+    }
+    m_local_position[to] = m_local_position[from];
+    m_local_rotation[to] = m_local_rotation[from];
+    m_local_scale[to] = m_local_scale[from];
+    m_matrices[to] = m_matrices[from];
+    m_dirty[to] = m_dirty[from];
 }
 
-void TransformComponent::rotate(const Quat &rotation) {
+void TransformStreams::update_matrix(size_t slot) {
+    TransformRef transform(*this, slot);
+    Mat4& matrix = m_matrices[slot].value;
+    matrix = glm::scale(glm::mat4_cast(transform.get_rotation()), transform.get_scale());
+    matrix[3] = Vec4(transform.get_position(), 1.0f);
+    m_dirty[slot] = 0;
+}
+
+// Composes T * R * S for the four transforms of a block per iteration. Each
+// field of the block is one aligned load, the rotation matrix is built
+// lane-wise, and each output column is transposed back per transform. Blocks
+// with nothing dirty are skipped.
+void TransformStreams::update_matrices() {
+    size_t blocks = (m_size + 3) / 4;
+
+    for (size_t b = 0; b < blocks; b++) {
+        size_t first = b * 4;
+        size_t last = first + 4 < m_size ? first + 4 : m_size;
+
+        bool dirty = false;
+        for (size_t slot = first; slot < last; slot++) {
+            dirty |= m_dirty[slot] != 0;
+        }
+        if (!dirty) {
+            continue;
+        }
+
+#ifdef GAME_TRANSFORM_SSE
+#define LOAD(f) _mm_load_ps(m_fields[f][b].v)
+        __m128 qx = LOAD(QX);
+        __m128 qy = LOAD(QY);
+        __m128 qz = LOAD(QZ);
+        __m128 qw = LOAD(QW);
+        __m128 sx = LOAD(SX);
+        __m128 sy = LOAD(SY);
+        __m128 sz = LOAD(SZ);
+        __m128 px = LOAD(PX);
+        __m128 py = LOAD(PY);
+        __m128 pz = LOAD(PZ);
+#undef LOAD
+
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+        __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+        __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+        // Column c, row r of the rotation, scaled by the column's scale factor
+        __m128 c0r0 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+        __m128 c0r1 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+        __m128 c0r2 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+        __m128 c1r0 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+        __m128 c1r1 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+        __m128 c1r2 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+        __m128 c2r0 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+        __m128 c2r1 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+        __m128 c2r2 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+        __m128 c0r3 = _mm_setzero_ps(), c1r3 = _mm_setzero_ps(), c2r3 = _mm_setzero_ps();
+        __m128 c3r3 = one;
+
+        _MM_TRANSPOSE4_PS(c0r0, c0r1, c0r2, c0r3);
+        _MM_TRANSPOSE4_PS(c1r0, c1r1, c1r2, c1r3);
+        _MM_TRANSPOSE4_PS(c2r0, c2r1, c2r2, c2r3);
+        _MM_TRANSPOSE4_PS(px, py, pz, c3r3);
+
+        // After the transposes register k of each column holds transform k's column.
+        // Clean slots are rewritten with the matrix they already had.
+        __m128 columns[4][4] = {
+            { c0r0, c1r0, c2r0, px },
+            { c0r1, c1r1, c2r1, py },
+            { c0r2, c1r2, c2r2, pz },
+            { c0r3, c1r3, c2r3, c3r3 },
+        };
+        for (size_t slot = first; slot < last; slot++) {
+            for (int c = 0; c < 4; c++) {
+                _mm_store_ps(&m_matrices[slot].value[c][0], columns[slot - first][c]);
+            }
+            m_dirty[slot] = 0;
+        }
+#else
+        for (size_t slot = first; slot < last; slot++) {
+            if (m_dirty[slot]) {
+                update_matrix(slot);
+            }
+        }
+#endif
+    }
+}
+// =============================================================== //
+
+
+// ========================= TransformRef ======================== //
+void TransformRef::rotate(const Quat &rotation) {
     set_rotation(glm::normalize(get_rotation() * rotation));
 }
 
-void TransformComponent::rotate(const Vec3 &axis, float angle_rads) {
+void TransformRef::rotate(const Vec3 &axis, float angle_rads) {
     rotate(glm::angleAxis(angle_rads, glm::normalize(axis)));
 }
 
-void TransformComponent::look_at(const Vec3 &target, const Vec3 &up) {
+void TransformRef::look_at(const Vec3 &target, const Vec3 &up) {
     Mat4 look = glm::lookAt(get_local_position(), target, up);
     set_local_rotation(glm::quat_cast(glm::inverse(look)));
 }
 
-Vec3 TransformComponent::forward() {
+Vec3 TransformRef::forward() const {
     return glm::normalize(get_rotation() * Vec3(0, 0, -1));
 }
 
-Vec3 TransformComponent::right() {
+Vec3 TransformRef::right() const {
     return glm::normalize(get_rotation() * Vec3(1, 0, 0));
 }
 
-Vec3 TransformComponent::up() {
+Vec3 TransformRef::up() const {
     return glm::normalize(get_rotation() * Vec3(0, 1, 0));
 }
 
-Vec3 TransformComponent::get_position() {
-    return Vec3(m_transform[3]);
+Vec3 TransformRef::get_position() const {
+    const TransformStreams& s = *m_streams;
+    return Vec3(s.field(TransformStreams::PX, m_slot),
+                s.field(TransformStreams::PY, m_slot),
+                s.field(TransformStreams::PZ, m_slot));
 }
 
-Vec3 TransformComponent::get_local_position() {
-    return Vec3(m_local_transform[3]);
+Vec3 TransformRef::get_local_position() const {
+    return m_streams->m_local_position[m_slot];
 }
 
-Quat TransformComponent::get_rotation() {
-    return glm::quat_cast(m_transform);
+Quat TransformRef::get_rotation() const {
+    const TransformStreams& s = *m_streams;
+    return Quat(s.field(TransformStreams::QW, m_slot),
+                s.field(TransformStreams::QX, m_slot),
+                s.field(TransformStreams::QY, m_slot),
+                s.field(TransformStreams::QZ, m_slot));
 }
 
-Quat TransformComponent::get_local_rotation() {
-    return glm::quat_cast(m_local_transform);
+Quat TransformRef::get_local_rotation() const {
+    return m_streams->m_local_rotation[m_slot];
 }
 
-Vec3 TransformComponent::get_scale() {
-    return Vec3(
-        glm::length(Vec3(m_transform[0])),
-        glm::length(Vec3(m_transform[1])),
-        glm::length(Vec3(m_transform[2]))
-        );
+Vec3 TransformRef::get_scale() const {
+    const TransformStreams& s = *m_streams;
+    return Vec3(s.field(TransformStreams::SX, m_slot),
+                s.field(TransformStreams::SY, m_slot),
+                s.field(TransformStreams::SZ, m_slot));
 }
 
-Vec3 TransformComponent::get_local_scale() {
-    return Vec3(
-        glm::length(Vec3(m_local_transform[0])),
-        glm::length(Vec3(m_local_transform[1])),
-        glm::length(Vec3(m_local_transform[2]))
-        );
+Vec3 TransformRef::get_local_scale() const {
+    return m_streams->m_local_scale[m_slot];
 }
 
-Mat4 TransformComponent::get_transform() {
-    return m_transform;
+const Mat4& TransformRef::get_transform() const {
+    if (is_dirty()) {
+        m_streams->update_matrix(m_slot);
+    }
+    return m_streams->m_matrices[m_slot].value;
 }
 
 
-void TransformComponent::set_position(const Vec3 &position) {
-    m_transform[3] = Vec4(position, 1.0f);
+void TransformRef::set_position(const Vec3 &position) {
+    TransformStreams& s = *m_streams;
+    s.field(TransformStreams::PX, m_slot) = position.x;
+    s.field(TransformStreams::PY, m_slot) = position.y;
+    s.field(TransformStreams::PZ, m_slot) = position.z;
+    s.m_dirty[m_slot] = 1;
 }
 
-void TransformComponent::set_local_position(const Vec3 &position) {
-    m_local_transform[3] = Vec4(position, 1.0f);
+void TransformRef::set_local_position(const Vec3 &position) {
+    m_streams->m_local_position[m_slot] = position;
 }
 
-void TransformComponent::set_rotation(const Quat &rotation) {
-    Vec3 scale = get_scale();
-    Vec3 pos = get_position();
-    m_transform = glm::mat4_cast(rotation);
-    m_transform = glm::scale(m_transform, scale);
-    set_position(pos);
+void TransformRef::set_rotation(const Quat &rotation) {
+    TransformStreams& s = *m_streams;
+    s.field(TransformStreams::QX, m_slot) = rotation.x;
+    s.field(TransformStreams::QY, m_slot) = rotation.y;
+    s.field(TransformStreams::QZ, m_slot) = rotation.z;
+    s.field(TransformStreams::QW, m_slot) = rotation.w;
+    s.m_dirty[m_slot] = 1;
 }
 
-void TransformComponent::set_local_rotation(const Quat &rotation) {
-    Vec3 scale = get_local_scale();
-    Vec3 pos = get_local_position();
-    m_local_transform = glm::mat4_cast(rotation);
-    m_local_transform = glm::scale(m_local_transform, scale);
-    set_local_position(pos);
+void TransformRef::set_local_rotation(const Quat &rotation) {
+    m_streams->m_local_rotation[m_slot] = rotation;
 }
 
-void TransformComponent::set_scale(const Vec3 &scale) {
-    Quat rot = get_rotation();
-    Vec3 pos = get_position();
-    m_transform = glm::mat4_cast(rot);
-    m_transform = glm::scale(m_transform, scale);
-    set_position(pos);
+void TransformRef::set_scale(const Vec3 &scale) {
+    TransformStreams& s = *m_streams;
+    s.field(TransformStreams::SX, m_slot) = scale.x;
+    s.field(TransformStreams::SY, m_slot) = scale.y;
+    s.field(TransformStreams::SZ, m_slot) = scale.z;
+    s.m_dirty[m_slot] = 1;
 }
 
-void TransformComponent::set_local_scale(const Vec3 &scale) {
-    Quat rot = get_local_rotation();
-    Vec3 pos = get_local_position();
-    m_local_transform = glm::mat4_cast(rot);
-    m_local_transform = glm::scale(m_local_transform, scale);
-    set_local_position(pos);
+void TransformRef::set_local_scale(const Vec3 &scale) {
+    m_streams->m_local_scale[m_slot] = scale;
 }
 
+void TransformRef::set_root(const Transform &transform) {
+    set_position(transform.position);
+    set_rotation(transform.rotation);
+    set_scale(transform.scale);
+    set_local_position(transform.position);
+    set_local_rotation(transform.rotation);
+    set_local_scale(transform.scale);
+}
 
+void TransformRef::update_world(const TransformRef& parent) {
+    Quat parent_rotation = parent.get_rotation();
+    Vec3 parent_scale = parent.get_scale();
+    set_position(parent.get_position() + parent_rotation * (parent_scale * get_local_position()));
+    set_rotation(parent_rotation * get_local_rotation());
+    set_scale(parent_scale * get_local_scale());
+}
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+void TransformRef::update_local(const TransformRef& parent) {
+    Quat inverse_rotation = glm::inverse(parent.get_rotation());
+    Vec3 parent_scale = parent.get_scale();
+    set_local_position((inverse_rotation * (get_position() - parent.get_position())) / parent_scale);
+    set_local_rotation(inverse_rotation * get_rotation());
+    set_local_scale(get_scale() / parent_scale);
+}
+// =============================================================== //
@@ -1,13 +1,96 @@
 #ifndef GAME_TRANSFORMCOMPONENT_H
 #define GAME_TRANSFORMCOMPONENT_H
 
-#include <interfaces/IComponent.h>
 #include <core/Types.h>
+#include <core/Relocatable.h>
+#include <core/ComponentColumns.h>
+#include <array>
+#include <cstdint>
 
-class TransformComponent : public IComponent {
+// Marks an entity as having a transform. The values live in the TransformStreams
+// of the pool, at the entity's dense slot, and are reached through a TransformRef:
+// views, queries and groups over TransformComponent yield one, and so does
+// World::transform().
+class TransformComponent {};
+
+// Position, rotation and scale as plain values, e.g. to place the instances of a
+// prefab, see World::instantiate()
+struct Transform {
+    Vec3 position = Vec3(0.0f);
+    Quat rotation = Quat(1.0f, 0.0f, 0.0f, 0.0f);
+    Vec3 scale = Vec3(1.0f);
+};
+
+class TransformRef;
+
+static_assert(is_trivially_relocatable_v<TransformComponent>, "TransformComponent must stay trivially relocatable");
+
+// Transforms of one pool split into one stream per field. The world space
+// position, rotation and scale are float streams padded to blocks of four, so
+// update_matrices() loads four transforms per field with a single aligned load.
+// The local values are only read when a parent moves and stay packed per
+// transform.
+class TransformStreams {
 public:
-    TransformComponent();
-    TransformComponent(const Vec3& position);
+    size_t size() const { return m_size; }
+
+    // Recomposes the world matrix of every transform written since the last call
+    void update_matrices();
+
+    // Pool hooks, see ComponentColumns.h. New slots hold the identity transform.
+    void append(size_t count);
+    void reset(size_t slot);
+    void swap(size_t a, size_t b);
+    void swap_remove(size_t slot);
+    void reserve(size_t capacity);
+
+    // The handle views, queries and groups yield for a slot. The const one has
+    // no setters, get_transform() still recomposes a dirty matrix.
+    TransformRef ref(TransformComponent& component, size_t slot);
+    const TransformRef ref(const TransformComponent& component, size_t slot) const;
+
+private:
+    friend class TransformRef;
+
+    // Four consecutive slots of one float field
+    struct alignas(16) Lanes {
+        float v[4];
+    };
+
+    struct alignas(16) Matrix {
+        Mat4 value;
+    };
+
+    enum Field { PX, PY, PZ, QX, QY, QZ, QW, SX, SY, SZ, FIELD_COUNT };
+
+    std::array<std::vector<Lanes>, FIELD_COUNT> m_fields;
+    std::vector<Vec3> m_local_position;
+    std::vector<Quat> m_local_rotation;
+    std::vector<Vec3> m_local_scale;
+    std::vector<Matrix> m_matrices; // Composed world matrix, valid when !m_dirty
+    std::vector<uint8_t> m_dirty;
+    size_t m_size = 0;
+
+    float& field(Field f, size_t slot) { return m_fields[f][slot / 4].v[slot % 4]; }
+    float field(Field f, size_t slot) const { return m_fields[f][slot / 4].v[slot % 4]; }
+
+    void move_slot(size_t from, size_t to);
+    void update_matrix(size_t slot);
+};
+
+template<>
+struct component_columns<TransformComponent> {
+    using type = TransformStreams;
+};
+
+// One transform in a TransformStreams. Like a component pointer it is only
+// valid until its pool adds, removes or reorders slots.
+class TransformRef {
+public:
+    TransformRef() = default;
+    TransformRef(TransformStreams& streams, size_t slot) : m_streams(&streams), m_slot(slot) {}
+
+    explicit operator bool() const { return m_streams != nullptr; }
 
     // Rotations
     void rotate(const Quat& rotation);
@@ -15,18 +98,18 @@ public:
 
     void look_at(const Vec3& target, const Vec3& up);
 
-    Vec3 forward();
-    Vec3 right();
-    Vec3 up();
+    Vec3 forward() const;
+    Vec3 right() const;
+    Vec3 up() const;
 
     // Getters
-    Vec3 get_position();
-    Vec3 get_local_position();
-    Quat get_rotation();
-    Quat get_local_rotation();
-    Vec3 get_scale();
-    Vec3 get_local_scale();
-    Mat4 get_transform();
+    Vec3 get_position() const;
+    Vec3 get_local_position() const;
+    Quat get_rotation() const;
+    Quat get_local_rotation() const;
+    Vec3 get_scale() const;
+    Vec3 get_local_scale() const;
+    const Mat4& get_transform() const;
 
     // Setters
     void set_position(const Vec3& position);
@@ -36,9 +119,30 @@ public:
     void set_scale(const Vec3& scale);
     void set_local_scale(const Vec3& scale);
 
+    // Sets the world and the local values, as for a transform without a parent
+    void set_root(const Transform& transform);
+
+    // Local values are relative to the parent entity and only used by entities
+    // that have one. These convert between the two spaces given the parent.
+    void update_world(const TransformRef& parent);
+    void update_local(const TransformRef& parent);
+
+    // The world matrix is composed from position, rotation and scale on demand.
+    // Setters only mark it dirty, TransformStreams::update_matrices() recomposes
+    // many at once.
+    bool is_dirty() const { return m_streams->m_dirty[m_slot] != 0; }
+
 private:
-    Mat4 m_transform;
-    Mat4 m_local_transform;
+    TransformStreams* m_streams = nullptr;
+    size_t m_slot = 0;
 };
 
-#endif //GAME_TRANSFORMCOMPONENT_H
\ No newline at end of file
+inline TransformRef TransformStreams::ref(TransformComponent&, size_t slot) {
+    return TransformRef(*this, slot);
+}
+
+inline const TransformRef TransformStreams::ref(const TransformComponent&, size_t slot) const {
+    return TransformRef(const_cast<TransformStreams&>(*this), slot);
+}
+
+#endif //GAME_TRANSFORMCOMPONENT_H
@@ -0,0 +1,31 @@
+#ifndef GAME_BITS_H
+#define GAME_BITS_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Portable wrappers for the bit scan and population count instructions
+
+// Index of the lowest set bit, word must not be zero
+inline uint32_t count_trailing_zeros(uint64_t word) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(word));
+#endif
+}
+
+inline uint32_t popcount(uint64_t word) {
+#if defined(_MSC_VER)
+    return static_cast<uint32_t>(__popcnt64(word));
+#else
+    return static_cast<uint32_t>(__builtin_popcountll(word));
+#endif
+}
+
+#endif //GAME_BITS_H
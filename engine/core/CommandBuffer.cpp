@@ -0,0 +1,61 @@
+#include "CommandBuffer.h"
+
+CommandBuffer::~CommandBuffer() {
+    clear();
+}
+
+void* CommandBuffer::allocate(CommandOp op, Entity entity, uint32_t payload_size) {
+    size_t size = record_size(payload_size);
+
+    if (m_blocks.empty() || m_blocks[m_current].used + size > m_blocks[m_current].capacity) {
+        if (!m_blocks.empty() && m_blocks[m_current].used > 0) {
+            ++m_current;
+        }
+
+        // Blocks past the current one are empty, reuse the next one if the record fits
+        if (m_current == m_blocks.size() || m_blocks[m_current].capacity < size) {
+            Block block;
+            block.capacity = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+            block.data = std::make_unique<Slot[]>(block.capacity / ALIGNMENT);
+            if (m_current == m_blocks.size()) {
+                m_blocks.push_back(std::move(block));
+            } else {
+                m_blocks[m_current] = std::move(block);
+            }
+        }
+    }
+
+    Block& block = m_blocks[m_current];
+    std::byte* record = block.data[0].bytes + block.used;
+    block.used += size;
+    ++m_count;
+
+    new (record) CommandHeader{ op, payload_size, entity, m_priority };
+    return record + HEADER_SIZE;
+}
+
+void CommandBuffer::push(CommandOp op, Entity entity, std::string_view text) {
+    std::memcpy(allocate(op, entity, static_cast<uint32_t>(text.size())), text.data(), text.size());
+}
+
+void CommandBuffer::push(CommandOp op, const Entity* entities, size_t count) {
+    std::memcpy(allocate(op, NULL_ENTITY, static_cast<uint32_t>(count * sizeof(Entity))), entities, count * sizeof(Entity));
+}
+
+void CommandBuffer::clear() {
+    for_each_record([](CommandHeader& header, void* payload) {
+        if (header.op == CommandOp::Invoke) {
+            InvokeRecord* record = static_cast<InvokeRecord*>(payload);
+            record->destroy(record + 1);
+        }
+    });
+    reset();
+}
+
+void CommandBuffer::reset() {
+    for (Block& block : m_blocks) {
+        block.used = 0;
+    }
+    m_current = 0;
+    m_count = 0;
+}
@@ -0,0 +1,176 @@
+#ifndef GAME_COMMANDBUFFER_H
+#define GAME_COMMANDBUFFER_H
+
+#include "Types.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+enum class CommandOp : uint16_t {
+    CreateEntities,     // Payload: Entity[]
+    DestroyEntity,
+    SetActiveCamera,
+    LoadMesh,           // Payload: file path characters
+    LoadMaterial,       // Payload: material id characters
+    SetBackfaceCulling, // Payload: bool
+    SetPosition,        // Payload: Vec3
+    SetRotation,        // Payload: Quat
+    SetScale,           // Payload: Vec3
+    Rotate,             // Payload: RotateCommand
+    SetParent,          // Payload: parent Entity
+    Invoke              // Payload: a callable, run by the buffer itself
+};
+
+struct CommandHeader {
+    CommandOp op;
+    uint32_t payload_size;
+    Entity entity;
+    int32_t priority; // Priority of the system that recorded it
+};
+
+// Reads a trivially copyable payload written by CommandBuffer::push
+template<typename T>
+T payload_as(const void* payload) {
+    static_assert(std::is_trivially_copyable_v<T>, "Command payloads must be trivially copyable");
+    T value;
+    std::memcpy(&value, payload, sizeof(T));
+    return value;
+}
+
+// Linear arena of command records, each a header followed by its payload.
+// Records are written into fixed blocks that are kept between frames, so once
+// the buffer has warmed up recording a command is a bump of an offset and a
+// memcpy. Commands that do not have an opcode are stored as an Invoke record
+// holding the callable in place. Every record is stamped with priority(), so
+// buffers from several threads can be merged in a fixed order.
+//
+// Not thread safe, the owner serializes access.
+class CommandBuffer {
+public:
+    static constexpr size_t ALIGNMENT = 16;
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    CommandBuffer() = default;
+    ~CommandBuffer();
+
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    // Appends a record and returns its payload_size bytes of payload storage
+    void* allocate(CommandOp op, Entity entity, uint32_t payload_size);
+
+    void push(CommandOp op, Entity entity) {
+        allocate(op, entity, 0);
+    }
+
+    template<typename Payload>
+    void push(CommandOp op, Entity entity, const Payload& payload) {
+        static_assert(std::is_trivially_copyable_v<Payload>, "Command payloads must be trivially copyable");
+        std::memcpy(allocate(op, entity, sizeof(Payload)), &payload, sizeof(Payload));
+    }
+
+    void push(CommandOp op, Entity entity, std::string_view text);
+    void push(CommandOp op, const Entity* entities, size_t count);
+
+    // Stores fn in the arena, it is called once when the buffer is executed
+    template<typename Fn>
+    void push_invoke(Fn&& fn) {
+        using F = std::decay_t<Fn>;
+        static_assert(alignof(F) <= ALIGNMENT, "Command is over-aligned for the command buffer");
+
+        void* payload = allocate(CommandOp::Invoke, NULL_ENTITY, static_cast<uint32_t>(sizeof(InvokeRecord) + sizeof(F)));
+        InvokeRecord* record = new (payload) InvokeRecord{ &invoke<F>, &destroy<F> };
+        new (record + 1) F(std::forward<Fn>(fn));
+    }
+
+    // Runs every record in submission order and empties the buffer. Invoke
+    // records are run here, all others go to dispatch(header, payload).
+    template<typename Dispatch>
+    void execute(Dispatch&& dispatch) {
+        for_each_record([&dispatch](CommandHeader& header, void* payload) {
+            run(header, payload, dispatch);
+        });
+        reset();
+    }
+
+    // Runs a single record handed out by for_each_record(), for callers that
+    // interleave the records of several buffers. Each record must be run once.
+    template<typename Dispatch>
+    static void run(const CommandHeader& header, void* payload, Dispatch& dispatch) {
+        if (header.op == CommandOp::Invoke) {
+            InvokeRecord* record = static_cast<InvokeRecord*>(payload);
+            record->invoke(record + 1);
+            record->destroy(record + 1);
+        } else {
+            dispatch(header, static_cast<const void*>(payload));
+        }
+    }
+
+    // Calls visit(header, payload) for every record in submission order
+    template<typename Visit>
+    void for_each_record(Visit visit) {
+        for (size_t b = 0; b < m_blocks.size() && b <= m_current; b++) {
+            std::byte* data = m_blocks[b].data[0].bytes;
+            for (size_t offset = 0; offset < m_blocks[b].used;) {
+                CommandHeader& header = *reinterpret_cast<CommandHeader*>(data + offset);
+                visit(header, data + offset + HEADER_SIZE);
+                offset += record_size(header.payload_size);
+            }
+        }
+    }
+
+    // Drops every record without running it
+    void clear();
+
+    // Empties the buffer once every record has been run(), keeping the blocks
+    void reset();
+
+    // Stamped on the records pushed from now on
+    void set_priority(int32_t priority) { m_priority = priority; }
+    int32_t priority() const { return m_priority; }
+
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+private:
+    struct alignas(ALIGNMENT) Slot {
+        std::byte bytes[ALIGNMENT];
+    };
+
+    struct Block {
+        std::unique_ptr<Slot[]> data;
+        size_t capacity = 0; // In bytes
+        size_t used = 0;
+    };
+
+    struct alignas(ALIGNMENT) InvokeRecord {
+        void (*invoke)(void* fn);
+        void (*destroy)(void* fn);
+    };
+
+    // The header takes one aligned slot, the payload starts right after it
+    static constexpr size_t HEADER_SIZE = (sizeof(CommandHeader) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+    template<typename F>
+    static void invoke(void* fn) { (*static_cast<F*>(fn))(); }
+
+    template<typename F>
+    static void destroy(void* fn) { static_cast<F*>(fn)->~F(); }
+
+    static size_t record_size(uint32_t payload_size) {
+        return HEADER_SIZE + (payload_size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    std::vector<Block> m_blocks;
+    size_t m_current = 0; // Block currently written to
+    size_t m_count = 0;
+    int32_t m_priority = 0;
+};
+
+#endif //GAME_COMMANDBUFFER_H
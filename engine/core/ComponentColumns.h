@@ -0,0 +1,46 @@
+#ifndef GAME_COMPONENTCOLUMNS_H
+#define GAME_COMPONENTCOLUMNS_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Per-slot data a component keeps next to its pool's dense array instead of in
+// the component itself, e.g. split into one stream per field so it can be
+// processed with aligned SIMD loads. The pool adds, moves and drops the columns
+// together with its slots, so slot i of the columns always belongs to the
+// entity in dense slot i.
+//
+// Components opt in by specializing the trait next to their definition.
+//
+// ref(component, slot) is what views, queries and groups yield for the slot.
+// Without columns that is the component itself, a component whose values live
+// in its columns hands out a handle into them instead.
+struct NoColumns {
+    void append(size_t) {}
+    void reset(size_t) {}
+    void swap(size_t, size_t) {}
+    void swap_remove(size_t) {}
+    void reserve(size_t) {}
+
+    template<typename T>
+    T& ref(T& component, size_t) const { return component; }
+};
+
+template<typename T>
+struct component_columns {
+    using type = NoColumns;
+};
+
+template<typename T>
+using component_columns_t = typename component_columns<T>::type;
+
+// What ref() yields for T, or for const T through const columns
+template<typename T>
+using component_ref_t = decltype(
+    std::declval<std::conditional_t<std::is_const_v<T>,
+                                    const component_columns_t<std::remove_const_t<T>>,
+                                    component_columns_t<T>>&>()
+        .ref(std::declval<T&>(), size_t()));
+
+#endif //GAME_COMPONENTCOLUMNS_H
@@ -2,47 +2,368 @@
 #define GAME_COMPONENTPOOL_H
 
 #include "Types.h"
-#include <unordered_map>
-#include <memory>
+#include "SparseArray.h"
+#include "DenseArray.h"
+#include "ComponentColumns.h"
+#include <interfaces/IGroup.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <numeric>
+#include <utility>
+#include <vector>
 
+// Reorders slots so that slot i receives what was in slot order[i], using only
+// swap(a, b) calls. Each cycle of the permutation costs one swap per element.
+template<typename Swap>
+void apply_permutation(std::vector<size_t>& order, Swap swap) {
+    for (size_t i = 0; i < order.size(); i++) {
+        size_t current = i;
+        while (order[current] != i) {
+            size_t next = order[current];
+            swap(current, next);
+            order[current] = current;
+            current = next;
+        }
+        order[current] = current;
+    }
+}
+
+class IComponentPool {
+public:
+    virtual ~IComponentPool() {}
+    virtual void remove(Entity entity) = 0;
+    virtual bool contains(Entity entity) const = 0;
+    virtual size_t size() const = 0;
+    virtual void set_tick(uint32_t tick) = 0;
+    virtual uint32_t version() const = 0;
+};
+
+// Sparse set storage for a single component type. Components are packed in a
+// dense array (in the same order as the entities that own them), and the sparse
+// array maps an entity index to its slot in the dense array.
+//
+// Each slot also records the tick it was added and last changed on. Writes are
+// stamped with tick(), which the World advances at the end of every
+// execute_commands(). A frame's window is therefore the mutable accesses made
+// by systems plus the command sync that follows them.
+//
+// Every mutable access counts as a write: the non-const get(), get_unchecked()
+// and patch() stamp the slot, the const overloads do not. data() and the
+// iterators hand out the raw dense array and leave stamping to the caller, see
+// mark_changed().
+//
+// version() changes whenever an entity is added, removed or moved to another
+// slot, which is what invalidates cached queries and component pointers.
+//
+// Components that specialize component_columns also get their columns kept
+// slot for slot with the dense array, see ComponentColumns.h.
 template<typename T>
-class ComponentPool {
+class ComponentPool : public IComponentPool {
 public:
-    using Map = std::unordered_map<uint32_t, std::unique_ptr<T>>;
-    using iterator = typename Map::iterator;
-    using const_iterator = typename Map::const_iterator;
+    static constexpr Entity INVALID = SparseArray::INVALID;
+
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    template<typename... Args>
+    T& emplace(Entity entity, Args&&... args) {
+        uint32_t index = entity_index(entity);
+        if (contains(entity)) {
+            size_t idx = m_sparse.get(index);
+            m_dense[idx] = T(std::forward<Args>(args)...);
+            m_columns.reset(idx);
+            stamp(idx);
+            return m_dense[idx];
+        }
+
+        assert(m_sparse.get(index) == INVALID && "Slot is held by a stale entity!");
+
+        m_sparse.set(index, static_cast<Entity>(m_dense.size()));
+        m_entities.push_back(entity);
+        m_dense.emplace_back(std::forward<Args>(args)...);
+        m_columns.append(1);
+        m_added_ticks.push_back(m_tick);
+        m_changed_ticks.push_back(m_tick);
+        m_last_changed.store(m_tick, std::memory_order_relaxed);
+        ++m_version;
+
+        if (m_group) {
+            m_group->on_add(entity);
+        }
+
+        return m_dense[m_sparse.get(index)];
+    }
+
+    T& add(Entity entity, T component) {
+        return emplace(entity, std::move(component));
+    }
+
+    // Bulk insert, components[i] goes to entities[i]. When none of the entities
+    // are in the pool yet, the values are appended in one range copy (a memcpy
+    // for trivially copyable types) and an owning group takes them in afterwards.
+    // An entity listed twice ends up with the later of its values.
+    void insert(const Entity* entities, size_t count, const T* components) {
+        if (append_entities(entities, count)) {
+            m_dense.append(components, count);
+            appended(entities, count);
+            return;
+        }
+        insert_with(entities, count, [components](size_t i) -> const T& { return components[i]; });
+    }
 
-    void add(Entity entity, std::unique_ptr<T> component) {
-        m_components[entity] = std::move(component);
+    // Bulk insert of one value for every entity
+    void insert(const Entity* entities, size_t count, const T& value) {
+        if (append_entities(entities, count)) {
+            m_dense.append(count, value);
+            appended(entities, count);
+            return;
+        }
+        insert_with(entities, count, [&value](size_t) -> const T& { return value; });
     }
 
+    // Marks the component as changed on the current tick
     T* get(Entity entity) {
-        auto it = m_components.find(entity);
-        return (it != m_components.end()) ? it->second.get() : nullptr;
+        if (!contains(entity)) {
+            return nullptr;
+        }
+
+        size_t idx = m_sparse.get(entity_index(entity));
+        stamp(idx);
+        return &m_dense[idx];
     }
 
     const T* get(Entity entity) const {
-        auto it = m_components.find(entity);
-        return (it != m_components.end()) ? it->second.get() : nullptr;
+        return contains(entity) ? &m_dense[m_sparse.get(entity_index(entity))] : nullptr;
+    }
+
+    // Same as get(), for call sites that want to say they write
+    T* patch(Entity entity) {
+        return get(entity);
+    }
+
+    // Caller guarantees contains(entity). Marks the component as changed.
+    T& get_unchecked(Entity entity) {
+        assert(contains(entity));
+        size_t idx = m_sparse.get(entity_index(entity));
+        stamp(idx);
+        return m_dense[idx];
+    }
+
+    const T& get_unchecked(Entity entity) const {
+        assert(contains(entity));
+        return m_dense[m_sparse.get(entity_index(entity))];
+    }
+
+    void remove(Entity entity) override {
+        if (!contains(entity)) {
+            return;
+        }
+
+        if (m_group) {
+            m_group->on_remove(entity);
+        }
+
+        // Move the last component into the freed slot to keep the dense array packed
+        size_t idx = m_sparse.get(entity_index(entity));
+        size_t last = m_dense.size() - 1;
+        m_dense.swap_remove(idx);
+        m_columns.swap_remove(idx);
+        if (idx != last) {
+            m_entities[idx] = m_entities[last];
+            m_added_ticks[idx] = m_added_ticks[last];
+            m_changed_ticks[idx] = m_changed_ticks[last];
+            m_sparse.set(entity_index(m_entities[idx]), static_cast<Entity>(idx));
+        }
+
+        m_entities.pop_back();
+        m_added_ticks.pop_back();
+        m_changed_ticks.pop_back();
+        m_sparse.set(entity_index(entity), INVALID);
+        ++m_version;
+    }
+
+    // The slot must also hold this exact handle, a stale generation is not a member
+    bool contains(Entity entity) const override {
+        Entity slot = m_sparse.get(entity_index(entity));
+        return slot != INVALID && m_entities[slot] == entity;
+    }
+
+    // Swaps two dense slots, keeping the sparse array in sync
+    void swap(size_t a, size_t b) {
+        if (a == b) {
+            return;
+        }
+
+        m_dense.swap_elements(a, b);
+        m_columns.swap(a, b);
+        std::swap(m_entities[a], m_entities[b]);
+        std::swap(m_added_ticks[a], m_added_ticks[b]);
+        std::swap(m_changed_ticks[a], m_changed_ticks[b]);
+        m_sparse.set(entity_index(m_entities[a]), static_cast<Entity>(a));
+        m_sparse.set(entity_index(m_entities[b]), static_cast<Entity>(b));
+        ++m_version;
+    }
+
+    // Sorts the dense array by comp over what ref() yields for const T, i.e.
+    // const T& or the columns' read only handle, moving the entities, ticks
+    // and columns along with their components. Not allowed on pools owned by a
+    // group, sort the group instead.
+    template<typename Compare>
+    void sort(Compare comp) {
+        assert(!m_group && "Pool is owned by a group!");
+        std::vector<size_t> order(size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::sort(order.begin(), order.end(), [this, &comp](size_t a, size_t b) {
+            return comp(std::as_const(*this).ref(a), std::as_const(*this).ref(b));
+        });
+        apply_permutation(order, [this](size_t a, size_t b) { swap(a, b); });
+    }
+
+    // Insertion sort for data that is already nearly in order, e.g. re-sorting
+    // every frame. Costs one pass when nothing moved.
+    template<typename Compare>
+    void sort_insertion(Compare comp) {
+        assert(!m_group && "Pool is owned by a group!");
+        for (size_t i = 1; i < size(); i++) {
+            for (size_t j = i; j > 0 && comp(std::as_const(*this).ref(j), std::as_const(*this).ref(j - 1)); j--) {
+                swap(j, j - 1);
+            }
+        }
+    }
+
+    size_t index_of(Entity entity) const {
+        assert(contains(entity));
+        return m_sparse.get(entity_index(entity));
     }
 
-    void remove(Entity entity) {
-        m_components.erase(entity);
+    // A pool can be owned by at most one group, which decides the order of its dense arrays
+    IGroup* group() const { return m_group; }
+    void set_group(IGroup* group) {
+        assert((!m_group || !group) && "Pool is already owned by a group!");
+        m_group = group;
     }
 
-    bool contains(Entity entity) const {
-        return m_components.find(entity) != m_components.end();
+    void set_tick(uint32_t tick) override { m_tick = tick; }
+    uint32_t tick() const { return m_tick; }
+    uint32_t version() const override { return m_version; }
+
+    // First tick of the last completed window, what change-filtered views compare against
+    uint32_t last_sync_tick() const { return m_tick - 1; }
+
+    // Caller guarantees contains(entity)
+    bool added_since(Entity entity, uint32_t tick) const {
+        return m_added_ticks[index_of(entity)] >= tick;
+    }
+
+    bool changed_since(Entity entity, uint32_t tick) const {
+        return m_changed_ticks[index_of(entity)] >= tick;
     }
 
-    size_t size() const { return m_components.size(); }
+    // Stamps dense slot idx as changed, for writes made through data()
+    void mark_changed(size_t idx) {
+        stamp(idx);
+    }
+
+    uint32_t changed_tick(size_t idx) const { return m_changed_ticks[idx]; }
 
-    iterator begin() { return m_components.begin(); }
-    iterator end()   { return m_components.end();   }
-    const_iterator begin() const { return m_components.begin(); }
-    const_iterator end()   const { return m_components.end();   }
+    // The latest tick any slot was stamped with, or 0 if none ever was, so a
+    // pass over the pool can be skipped when nothing in it changed
+    uint32_t last_changed_tick() const { return m_last_changed.load(std::memory_order_relaxed); }
+
+    void reserve(size_t capacity) {
+        m_dense.reserve(capacity);
+        m_columns.reserve(capacity);
+        m_entities.reserve(capacity);
+        m_added_ticks.reserve(capacity);
+        m_changed_ticks.reserve(capacity);
+    }
+
+    size_t size() const override { return m_dense.size(); }
+
+    // Entities in dense order, entities()[i] owns data()[i]
+    const std::vector<Entity>& entities() const { return m_entities; }
+    const SparseArray& sparse() const { return m_sparse; }
+    T* data() { return m_dense.data(); }
+    const T* data() const { return m_dense.data(); }
+
+    // columns() slot i belongs to entities()[i]
+    component_columns_t<T>& columns() { return m_columns; }
+    const component_columns_t<T>& columns() const { return m_columns; }
+
+    // What views and groups yield for dense slot idx, see ComponentColumns.h.
+    // Does not stamp the slot.
+    component_ref_t<T> ref(size_t idx) { return m_columns.ref(m_dense[idx], idx); }
+    component_ref_t<const T> ref(size_t idx) const { return m_columns.ref(m_dense[idx], idx); }
+
+    iterator begin() { return m_dense.begin(); }
+    iterator end()   { return m_dense.end();   }
+    const_iterator begin() const { return m_dense.begin(); }
+    const_iterator end()   const { return m_dense.end();   }
 
 private:
-    Map m_components;
+    // Appends everything but the components for a batch of new entities, or
+    // returns false if the batch has to go through emplace() one by one. That
+    // is the case when an entity is already in the pool or appears twice in
+    // the batch, a repeat is only seen once its first occurrence has claimed
+    // the sparse entry, so the entries claimed so far are released again.
+    bool append_entities(const Entity* entities, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            uint32_t index = entity_index(entities[i]);
+            if (m_sparse.get(index) != INVALID) {
+                for (size_t j = 0; j < i; j++) {
+                    m_sparse.set(entity_index(entities[j]), INVALID);
+                }
+                return false;
+            }
+            m_sparse.set(index, static_cast<Entity>(m_dense.size() + i));
+        }
+
+        reserve(size() + count);
+        m_entities.insert(m_entities.end(), entities, entities + count);
+        m_columns.append(count);
+        m_added_ticks.insert(m_added_ticks.end(), count, m_tick);
+        m_changed_ticks.insert(m_changed_ticks.end(), count, m_tick);
+        m_last_changed.store(m_tick, std::memory_order_relaxed);
+        ++m_version;
+        return true;
+    }
+
+    // Slots of one pool can be stamped from many threads at once, the shared
+    // tick is only written by the first of them
+    void stamp(size_t idx) {
+        m_changed_ticks[idx] = m_tick;
+        if (m_last_changed.load(std::memory_order_relaxed) != m_tick) {
+            m_last_changed.store(m_tick, std::memory_order_relaxed);
+        }
+    }
+
+    // Runs once the components of an append_entities() batch are in place
+    void appended(const Entity* entities, size_t count) {
+        if (m_group) {
+            m_group->on_append(entities, count);
+        }
+    }
+
+    template<typename ValueAt>
+    void insert_with(const Entity* entities, size_t count, ValueAt value_at) {
+        reserve(size() + count);
+
+        for (size_t i = 0; i < count; i++) {
+            emplace(entities[i], value_at(i));
+        }
+    }
+
+    DenseArray<T> m_dense;
+    component_columns_t<T> m_columns;
+    std::vector<Entity> m_entities;
+    std::vector<uint32_t> m_added_ticks;
+    std::vector<uint32_t> m_changed_ticks;
+    SparseArray m_sparse;
+    IGroup* m_group = nullptr;
+    uint32_t m_tick = 1;
+    uint32_t m_version = 0;
+    std::atomic<uint32_t> m_last_changed{0};
 };
 
-#endif //GAME_COMPONENTPOOL_H
\ No newline at end of file
+#endif //GAME_COMPONENTPOOL_H
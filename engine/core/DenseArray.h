@@ -0,0 +1,172 @@
+#ifndef GAME_DENSEARRAY_H
+#define GAME_DENSEARRAY_H
+
+#include "Relocatable.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Packed storage for the components of a pool. Trivially relocatable types are
+// grown with realloc and moved around with memcpy, every other type is moved
+// element by element like std::vector does.
+template<typename T>
+class DenseArray {
+    static constexpr bool RELOCATE = is_trivially_relocatable_v<T> && alignof(T) <= alignof(std::max_align_t);
+
+    static_assert(!(is_trivially_relocatable_v<T> && std::is_polymorphic_v<T>),
+                  "Polymorphic types cannot be trivially relocatable");
+
+public:
+    DenseArray() = default;
+
+    ~DenseArray() {
+        clear();
+        deallocate(m_data);
+    }
+
+    DenseArray(const DenseArray&) = delete;
+    DenseArray& operator=(const DenseArray&) = delete;
+
+    T& operator[](size_t idx) { return m_data[idx]; }
+    const T& operator[](size_t idx) const { return m_data[idx]; }
+
+    T& back() { return m_data[m_size - 1]; }
+
+    T* data() { return m_data; }
+    const T* data() const { return m_data; }
+
+    T* begin() { return m_data; }
+    T* end() { return m_data + m_size; }
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    void reserve(size_t capacity) {
+        if (capacity > m_capacity) {
+            reallocate(capacity);
+        }
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (m_size == m_capacity) {
+            // The arguments may refer into this array, construct before growing
+            T value(std::forward<Args>(args)...);
+            ensure_capacity(m_size + 1);
+            return *new (m_data + m_size++) T(std::move(value));
+        }
+        return *new (m_data + m_size++) T(std::forward<Args>(args)...);
+    }
+
+    void pop_back() {
+        assert(m_size > 0);
+        m_data[--m_size].~T();
+    }
+
+    // Appends copies of components[0, count)
+    void append(const T* components, size_t count) {
+        ensure_capacity(m_size + count);
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            std::memcpy(static_cast<void*>(m_data + m_size), components, count * sizeof(T));
+        } else {
+            std::uninitialized_copy(components, components + count, m_data + m_size);
+        }
+        m_size += count;
+    }
+
+    // Appends count copies of value
+    void append(size_t count, const T& value) {
+        ensure_capacity(m_size + count);
+        std::uninitialized_fill_n(m_data + m_size, count, value);
+        m_size += count;
+    }
+
+    // Destroys the element at idx and moves the last one into its place
+    void swap_remove(size_t idx) {
+        assert(idx < m_size);
+        size_t last = m_size - 1;
+        if constexpr (RELOCATE) {
+            m_data[idx].~T();
+            if (idx != last) {
+                std::memcpy(static_cast<void*>(m_data + idx), m_data + last, sizeof(T));
+            }
+            --m_size;
+        } else {
+            if (idx != last) {
+                m_data[idx] = std::move(m_data[last]);
+            }
+            pop_back();
+        }
+    }
+
+    void swap_elements(size_t a, size_t b) {
+        if constexpr (RELOCATE) {
+            alignas(T) unsigned char tmp[sizeof(T)];
+            std::memcpy(tmp, m_data + a, sizeof(T));
+            std::memcpy(static_cast<void*>(m_data + a), m_data + b, sizeof(T));
+            std::memcpy(static_cast<void*>(m_data + b), tmp, sizeof(T));
+        } else {
+            std::swap(m_data[a], m_data[b]);
+        }
+    }
+
+    void clear() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (size_t i = 0; i < m_size; i++) {
+                m_data[i].~T();
+            }
+        }
+        m_size = 0;
+    }
+
+private:
+    T* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+
+    // Grows geometrically so repeated appends stay amortized O(1)
+    void ensure_capacity(size_t required) {
+        if (required <= m_capacity) {
+            return;
+        }
+
+        size_t capacity = m_capacity * 2 > 8 ? m_capacity * 2 : 8;
+        reallocate(capacity > required ? capacity : required);
+    }
+
+    void reallocate(size_t capacity) {
+        if constexpr (RELOCATE) {
+            void* data = std::realloc(static_cast<void*>(m_data), capacity * sizeof(T));
+            if (!data) {
+                throw std::bad_alloc();
+            }
+            m_data = static_cast<T*>(data);
+        } else {
+            T* data = static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+            for (size_t i = 0; i < m_size; i++) {
+                new (data + i) T(std::move(m_data[i]));
+                m_data[i].~T();
+            }
+            deallocate(m_data);
+            m_data = data;
+        }
+        m_capacity = capacity;
+    }
+
+    static void deallocate(T* data) {
+        if constexpr (RELOCATE) {
+            std::free(data);
+        } else if (data) {
+            ::operator delete(data, std::align_val_t(alignof(T)));
+        }
+    }
+};
+
+#endif //GAME_DENSEARRAY_H
@@ -1,26 +1,74 @@
 #include "EntityPool.h"
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <iostream>
 
-EntityPool::EntityPool(size_t max_entities)
-    :   m_next(1),
-        m_capacity(max_entities)
+namespace {
+    // Generation of a retired slot, no handle can carry it
+    constexpr uint32_t RETIRED_GENERATION = ENTITY_GENERATION_MASK + 1;
+}
+
+EntityPool::EntityPool()
+    :   m_generations(1, 0) // Slot 0 is reserved for NULL_ENTITY
 {}
 
 Entity EntityPool::create() {
-    if (!m_free.empty()) {
-        Entity id = m_free.back();
-        m_free.pop_back();
-        return id;
+    if (m_free.size() > MIN_FREE_SLOTS) {
+        uint32_t index = m_free.front();
+        m_free.pop_front();
+        return make_entity(index, m_generations[index]);
     }
 
-    assert(m_next < m_capacity && "Exceeded maximum number of entities!");
-    return m_next++;
+    return make_entity(grow(1), 0);
 }
 
-void EntityPool::destroy(Entity entity) {
-    assert(entity < m_capacity && "Entity out of bounds!");
-    m_free.push_back(entity);
+void EntityPool::create(size_t count, std::vector<Entity>& out) {
+    out.reserve(out.size() + count);
+
+    // Recycled slots first, then grow the generation array once for the rest
+    size_t recycled = m_free.size() > MIN_FREE_SLOTS ? std::min(count, m_free.size() - MIN_FREE_SLOTS) : 0;
+    for (size_t i = 0; i < recycled; i++) {
+        out.push_back(create());
+    }
+
+    size_t fresh = count - recycled;
+    uint32_t first = grow(fresh);
+    for (size_t i = 0; i < fresh; i++) {
+        out.push_back(make_entity(first + static_cast<uint32_t>(i), 0));
+    }
 }
 
+uint32_t EntityPool::grow(size_t count) {
+    // Checked in every build, an index past the handle bits would alias slot 0 and up
+    if (m_generations.size() + count > MAX_ENTITIES) {
+        std::cerr << "Exceeded maximum number of entities (" << MAX_ENTITIES - 1 << ")." << std::endl;
+        std::abort();
+    }
 
+    uint32_t first = static_cast<uint32_t>(m_generations.size());
+    m_generations.resize(m_generations.size() + count, 0);
+    return first;
+}
 
+void EntityPool::destroy(Entity entity) {
+    assert(is_alive(entity) && "Entity is not alive!");
+    uint32_t index = entity_index(entity);
+    if (m_generations[index] == ENTITY_GENERATION_MASK) {
+        m_generations[index] = RETIRED_GENERATION;
+        return;
+    }
+
+    ++m_generations[index];
+    m_free.push_back(index);
+}
+
+bool EntityPool::is_alive(Entity entity) const {
+    uint32_t index = entity_index(entity);
+    return index != 0 && index < m_generations.size() && m_generations[index] == entity_generation(entity);
+}
+
+Entity EntityPool::handle(uint32_t index) const {
+    assert(index < m_generations.size() && m_generations[index] != RETIRED_GENERATION);
+    return make_entity(index, m_generations[index]);
+}
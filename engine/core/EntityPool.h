@@ -2,20 +2,39 @@
 #define GAME_ENTITYPOOL_H
 
 #include "Types.h"
+#include <deque>
 #include <vector>
 
+// Hands out generational entity handles. Slots are only limited by the index
+// bits of a handle, MAX_ENTITIES - 1 of them (slot 0 is NULL_ENTITY), the 12
+// generation bits are what keeps stale handles from matching a recycled slot.
+//
+// Freed slots are reused first in, first out, and only once MIN_FREE_SLOTS of
+// them are waiting, so a hot spawn/despawn loop cycles through many slots
+// instead of bumping one slot's generation every time. A slot whose generation
+// is used up is retired instead of wrapping back to a generation that old
+// handles still carry.
 class EntityPool {
 public:
-    EntityPool(size_t max_entities);
+    static constexpr size_t MIN_FREE_SLOTS = 1024;
+
+    EntityPool();
 
     Entity create();
+    void create(size_t count, std::vector<Entity>& out);
     void destroy(Entity entity);
+    bool is_alive(Entity entity) const;
+
+    // The current handle of a slot, for storages that only keep entity indices
+    Entity handle(uint32_t index) const;
 
 private:
-    std::vector<Entity> m_free;
-    size_t m_next;
-    size_t m_capacity;
+    std::vector<uint32_t> m_generations; // Current generation of each slot, indexed by entity_index()
+    std::deque<uint32_t> m_free;         // Recycled slot indices, oldest first
+
+    // Grows m_generations by count fresh slots and returns the first one
+    uint32_t grow(size_t count);
 };
 
 
-#endif //GAME_ENTITYPOOL_H
\ No newline at end of file
+#endif //GAME_ENTITYPOOL_H
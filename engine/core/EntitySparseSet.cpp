@@ -1,37 +1,32 @@
 #include "EntitySparseSet.h"
 #include <cassert>
 
-EntitySparseSet::EntitySparseSet(size_t max_entities)
-    : m_sparse(max_entities, INVALID)
-{}
-
 void EntitySparseSet::insert(Entity entity) {
-    assert(entity < m_sparse.size());
-    assert(m_sparse[entity] == INVALID && "Entity is already in set!");
-    m_sparse[entity] = static_cast<Entity>(m_dense.size());
+    uint32_t index = entity_index(entity);
+    assert(m_sparse.get(index) == INVALID && "Entity is already in set!");
+    m_sparse.set(index, static_cast<Entity>(m_dense.size()));
     m_dense.push_back(entity);
 }
 
+void EntitySparseSet::insert(const Entity* entities, size_t count) {
+    m_dense.reserve(m_dense.size() + count);
+    for (size_t i = 0; i < count; i++) {
+        insert(entities[i]);
+    }
+}
 
 void EntitySparseSet::erase(Entity entity) {
     assert(contains(entity));
     Entity last = m_dense.back();
-    size_t idx = m_sparse[entity];
+    size_t idx = m_sparse.get(entity_index(entity));
     m_dense[idx] = last;
-    m_sparse[last] = static_cast<Entity>(idx);
+    m_sparse.set(entity_index(last), static_cast<Entity>(idx));
     m_dense.pop_back();
-    m_sparse[entity] = INVALID;
+    m_sparse.set(entity_index(entity), INVALID);
 }
 
+// The slot must also hold this exact handle, a stale generation is not a member
 bool EntitySparseSet::contains(Entity entity) const {
-    return entity < m_sparse.size() && m_sparse[entity] != INVALID;
+    Entity slot = m_sparse.get(entity_index(entity));
+    return slot != INVALID && m_dense[slot] == entity;
 }
-
-
-
-
-
-
-
-
-
@@ -2,15 +2,15 @@
 #define GAME_SPARSESET_H
 
 #include "Types.h"
-#include <limits>
+#include "SparseArray.h"
 #include <vector>
 
 class EntitySparseSet {
 public:
-     static constexpr Entity INVALID = std::numeric_limits<Entity>::max();
+     static constexpr Entity INVALID = SparseArray::INVALID;
 
-     EntitySparseSet(size_t max_entities);
      void insert(Entity entity);
+     void insert(const Entity* entities, size_t count);
      void erase(Entity entity);
      bool contains(Entity entity) const;
 
@@ -19,7 +19,7 @@ public:
 
 private:
      std::vector<Entity> m_dense;
-     std::vector<Entity> m_sparse;
+     SparseArray m_sparse;
 };
 
 
@@ -0,0 +1,179 @@
+#ifndef GAME_GROUP_H
+#define GAME_GROUP_H
+
+#include "ComponentPool.h"
+#include <interfaces/IGroup.h>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <utility>
+
+// An owning group takes over the ordering of the pools for Ts. Whenever an
+// entity gains the last of the grouped components it is swapped into slot
+// size() of every pool, and swapped back out before it loses one. The first
+// size() entries of each pool are then the same entities in the same order,
+// so iterating the group walks parallel arrays with no lookups at all.
+template<typename... Ts>
+class Group : public IGroup {
+    static_assert(sizeof...(Ts) > 1, "A group needs at least two component types");
+
+public:
+    Group(ComponentPool<Ts>&... pools)
+        : m_pools(&pools...)
+    {
+        (pools.set_group(this), ...);
+
+        // Pull in the entities that already have every grouped component
+        const std::vector<Entity>& entities = lead().entities();
+        for (size_t i = 0; i < entities.size(); i++) {
+            on_add(entities[i]);
+        }
+    }
+
+    ~Group() override {
+        std::apply([](auto*... pools) { (pools->set_group(nullptr), ...); }, m_pools);
+    }
+
+    Group(const Group&) = delete;
+    Group& operator=(const Group&) = delete;
+
+    void on_add(Entity entity) override {
+        if (!all_of(entity) || lead().index_of(entity) < m_size) {
+            return;
+        }
+
+        std::apply([this, entity](auto*... pools) {
+            (pools->swap(pools->index_of(entity), m_size), ...);
+        }, m_pools);
+        ++m_size;
+    }
+
+    // The batch sits at the end of the pool, so this is one pass that swaps the
+    // entities that now have every grouped component into the group
+    void on_append(const Entity* entities, size_t count) override {
+        for (size_t i = 0; i < count; i++) {
+            on_add(entities[i]);
+        }
+    }
+
+    void on_remove(Entity entity) override {
+        if (!contains(entity)) {
+            return;
+        }
+
+        --m_size;
+        std::apply([this, entity](auto*... pools) {
+            (pools->swap(pools->index_of(entity), m_size), ...);
+        }, m_pools);
+    }
+
+    bool contains(Entity entity) const {
+        return all_of(entity) && lead().index_of(entity) < m_size;
+    }
+
+    // Iterating a non-const group yields Ts& and stamps every visited component
+    // as changed, a const group yields const Ts& and does not, see ComponentPool.
+    // Components kept in columns are yielded as their handle, as in a view.
+    template<typename GroupPtr>
+    class BasicIter {
+    public:
+        GroupPtr group{};
+        size_t idx{};
+
+        auto operator*() const {
+            return group->get(idx);
+        }
+
+        BasicIter& operator++() {
+            ++idx;
+            return *this;
+        }
+
+        bool operator!=(const BasicIter& o) const {
+            return idx != o.idx;
+        }
+    };
+
+    using Iter = BasicIter<Group*>;
+    using ConstIter = BasicIter<const Group*>;
+
+    Iter begin() { return Iter{this, 0}; }
+    Iter end() { return Iter{this, m_size}; }
+    ConstIter begin() const { return ConstIter{this, 0}; }
+    ConstIter end() const { return ConstIter{this, m_size}; }
+
+    // Calls fn(Entity, Ts&...) for every entity in the group
+    template<typename Fn>
+    void each(Fn&& fn) {
+        for (size_t i = 0; i < m_size; i++) {
+            std::apply(fn, get(i));
+        }
+    }
+
+    // Calls fn(Entity, const Ts&...) for every entity in the group
+    template<typename Fn>
+    void each(Fn&& fn) const {
+        for (size_t i = 0; i < m_size; i++) {
+            std::apply(fn, get(i));
+        }
+    }
+
+    size_t size() const { return m_size; }
+
+    // Changes whenever one of the grouped pools gains, loses or reorders an entity
+    uint32_t version() const {
+        return std::apply([](auto*... pools) { return (pools->version() + ...); }, m_pools);
+    }
+
+    // Sorts the group by comp on the grouped component T, called with what a
+    // const view yields for T (const T&, or e.g. a const TransformRef). The same
+    // order is applied to every pool so they stay aligned.
+    template<typename T, typename Compare>
+    void sort(Compare comp) {
+        const ComponentPool<T>& pool = *std::get<ComponentPool<T>*>(m_pools);
+        std::vector<size_t> order(m_size);
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::sort(order.begin(), order.end(), [&pool, &comp](size_t a, size_t b) {
+            return comp(pool.ref(a), pool.ref(b));
+        });
+        apply_permutation(order, [this](size_t a, size_t b) { swap(a, b); });
+    }
+
+    // Insertion sort for groups that are already nearly in order
+    template<typename T, typename Compare>
+    void sort_insertion(Compare comp) {
+        const ComponentPool<T>& pool = *std::get<ComponentPool<T>*>(m_pools);
+        for (size_t i = 1; i < m_size; i++) {
+            for (size_t j = i; j > 0 && comp(pool.ref(j), pool.ref(j - 1)); j--) {
+                swap(j, j - 1);
+            }
+        }
+    }
+
+private:
+    std::tuple<ComponentPool<Ts>*...> m_pools;
+    size_t m_size = 0;
+
+    auto& lead() const { return *std::get<0>(m_pools); }
+
+    void swap(size_t a, size_t b) {
+        std::apply([a, b](auto*... pools) { (pools->swap(a, b), ...); }, m_pools);
+    }
+
+    bool all_of(Entity entity) const {
+        return std::apply([entity](auto*... pools) {
+            return (pools->contains(entity) && ...);
+        }, m_pools);
+    }
+
+    std::tuple<Entity, component_ref_t<Ts>...> get(size_t idx) {
+        (std::get<ComponentPool<Ts>*>(m_pools)->mark_changed(idx), ...);
+        return { lead().entities()[idx], std::get<ComponentPool<Ts>*>(m_pools)->ref(idx)... };
+    }
+
+    std::tuple<Entity, component_ref_t<const Ts>...> get(size_t idx) const {
+        return { lead().entities()[idx], std::as_const(*std::get<ComponentPool<Ts>*>(m_pools)).ref(idx)... };
+    }
+};
+
+#endif //GAME_GROUP_H
@@ -0,0 +1,130 @@
+#include "Hierarchy.h"
+
+bool Hierarchy::set_parent(Entity child, Entity parent) {
+    if (child == parent || (parent != NULL_ENTITY && is_descendant(parent, child))) {
+        return false;
+    }
+
+    grow(entity_index(child));
+    unlink(child);
+
+    if (parent != NULL_ENTITY) {
+        grow(entity_index(parent));
+        uint32_t index = entity_index(child);
+        m_parents[index] = parent;
+        m_next_siblings[index] = m_first_children[entity_index(parent)];
+        m_first_children[entity_index(parent)] = child;
+    }
+
+    update_depths(child);
+    m_order_dirty = true;
+    return true;
+}
+
+void Hierarchy::remove(Entity entity) {
+    uint32_t index = entity_index(entity);
+    if (index >= m_parents.size()) {
+        return;
+    }
+
+    unlink(entity);
+
+    Entity child = m_first_children[index];
+    while (child != NULL_ENTITY) {
+        uint32_t child_index = entity_index(child);
+        Entity next = m_next_siblings[child_index];
+        m_parents[child_index] = NULL_ENTITY;
+        m_next_siblings[child_index] = NULL_ENTITY;
+        update_depths(child);
+        child = next;
+    }
+
+    m_first_children[index] = NULL_ENTITY;
+    m_depths[index] = 0;
+    m_order_dirty = true;
+}
+
+bool Hierarchy::is_descendant(Entity entity, Entity ancestor) const {
+    for (Entity current = parent(entity); current != NULL_ENTITY; current = parent(current)) {
+        if (current == ancestor) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Rebuilt breadth first from every root, only after the links changed
+const std::vector<Entity>& Hierarchy::depth_order() {
+    if (!m_order_dirty) {
+        return m_order;
+    }
+
+    m_order.clear();
+    for (uint32_t index = 0; index < m_parents.size(); index++) {
+        if (m_parents[index] != NULL_ENTITY || m_first_children[index] == NULL_ENTITY) {
+            continue;
+        }
+
+        size_t level = m_order.size();
+        for (Entity child = m_first_children[index]; child != NULL_ENTITY; child = m_next_siblings[entity_index(child)]) {
+            m_order.push_back(child);
+        }
+        for (; level < m_order.size(); level++) {
+            for (Entity child = m_first_children[entity_index(m_order[level])]; child != NULL_ENTITY; child = m_next_siblings[entity_index(child)]) {
+                m_order.push_back(child);
+            }
+        }
+    }
+
+    m_order_dirty = false;
+    m_slots_valid = false;
+    return m_order;
+}
+
+void Hierarchy::grow(uint32_t index) {
+    if (index < m_parents.size()) {
+        return;
+    }
+
+    size_t size = index + 1;
+    m_parents.resize(size, NULL_ENTITY);
+    m_first_children.resize(size, NULL_ENTITY);
+    m_next_siblings.resize(size, NULL_ENTITY);
+    m_depths.resize(size, 0);
+}
+
+// Removes child from its parent's child list
+void Hierarchy::unlink(Entity child) {
+    uint32_t index = entity_index(child);
+    Entity parent = m_parents[index];
+    if (parent == NULL_ENTITY) {
+        return;
+    }
+
+    Entity* link = &m_first_children[entity_index(parent)];
+    while (*link != child) {
+        link = &m_next_siblings[entity_index(*link)];
+    }
+    *link = m_next_siblings[index];
+
+    m_parents[index] = NULL_ENTITY;
+    m_next_siblings[index] = NULL_ENTITY;
+}
+
+// Recomputes the depth of root and everything below it without recursion
+void Hierarchy::update_depths(Entity root) {
+    Entity parent = m_parents[entity_index(root)];
+    m_depths[entity_index(root)] = parent == NULL_ENTITY ? 0 : m_depths[entity_index(parent)] + 1;
+
+    std::vector<Entity> stack = { root };
+    while (!stack.empty()) {
+        Entity entity = stack.back();
+        stack.pop_back();
+
+        uint32_t depth = m_depths[entity_index(entity)] + 1;
+        for (Entity child = m_first_children[entity_index(entity)]; child != NULL_ENTITY; child = m_next_siblings[entity_index(child)]) {
+            m_depths[entity_index(child)] = depth;
+            stack.push_back(child);
+        }
+    }
+}
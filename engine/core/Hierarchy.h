@@ -0,0 +1,87 @@
+#ifndef GAME_HIERARCHY_H
+#define GAME_HIERARCHY_H
+
+#include "Types.h"
+#include <cstdint>
+#include <vector>
+
+// Parent/child links stored as flat arrays indexed by entity_index(). Children
+// form a singly linked list through next_sibling(). depth_order() lists every
+// entity that has a parent, parents before their children, so a single linear
+// pass can propagate transforms down the whole scene.
+class Hierarchy {
+public:
+    // Links child under parent, or detaches it when parent is NULL_ENTITY.
+    // Returns false if parent is child itself or one of its descendants.
+    bool set_parent(Entity child, Entity parent);
+
+    // Detaches entity from its parent, its children become roots
+    void remove(Entity entity);
+
+    Entity parent(Entity entity) const { return at(m_parents, entity, NULL_ENTITY); }
+    Entity first_child(Entity entity) const { return at(m_first_children, entity, NULL_ENTITY); }
+    Entity next_sibling(Entity entity) const { return at(m_next_siblings, entity, NULL_ENTITY); }
+    uint32_t depth(Entity entity) const { return at(m_depths, entity, 0u); }
+
+    bool is_descendant(Entity entity, Entity ancestor) const;
+
+    const std::vector<Entity>& depth_order();
+
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    // A depth_order() entry and its parent as slots of some dense array
+    struct SlotLink {
+        uint32_t slot;
+        uint32_t parent_slot;
+    };
+
+    // depth_order() resolved to dense slots by slot_of(Entity), which returns
+    // NO_SLOT for entities that are not in the array. Entries where either side
+    // has no slot are left out. The result is cached and resolved again only
+    // when the links change or slots_version, the version of the array, moves.
+    template<typename SlotOf>
+    const std::vector<SlotLink>& slot_order(uint32_t slots_version, SlotOf slot_of) {
+        const std::vector<Entity>& order = depth_order();
+        if (m_slots_valid && slots_version == m_slots_version) {
+            return m_slot_order;
+        }
+
+        m_slot_order.clear();
+        for (Entity entity : order) {
+            uint32_t slot = slot_of(entity);
+            uint32_t parent_slot = slot_of(parent(entity));
+            if (slot != NO_SLOT && parent_slot != NO_SLOT) {
+                m_slot_order.push_back({ slot, parent_slot });
+            }
+        }
+
+        m_slots_version = slots_version;
+        m_slots_valid = true;
+        return m_slot_order;
+    }
+
+private:
+    template<typename V>
+    static V at(const std::vector<V>& values, Entity entity, V fallback) {
+        uint32_t index = entity_index(entity);
+        return index < values.size() ? values[index] : fallback;
+    }
+
+    void grow(uint32_t index);
+    void unlink(Entity child);
+    void update_depths(Entity root);
+
+    std::vector<Entity> m_parents;
+    std::vector<Entity> m_first_children;
+    std::vector<Entity> m_next_siblings;
+    std::vector<uint32_t> m_depths;
+
+    std::vector<Entity> m_order;
+    bool m_order_dirty = false;
+
+    std::vector<SlotLink> m_slot_order;
+    uint32_t m_slots_version = 0;
+    bool m_slots_valid = false; // Cleared whenever m_order is rebuilt
+};
+
+#endif //GAME_HIERARCHY_H
@@ -0,0 +1,133 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace {
+    // Set on threads that are inside a parallel_for, nested calls run inline
+    thread_local bool t_in_job = false;
+
+    // order_key() of the chunk the thread is running, 0 outside of one
+    thread_local uint64_t t_order_key = 0;
+
+    constexpr uint64_t AFTER_CHUNKS = 0xFFFFFFFF;
+
+    uint64_t make_order_key(uint64_t call, uint64_t chunk) {
+        return call << 32 | chunk;
+    }
+}
+
+JobSystem::JobSystem(size_t worker_count) {
+    m_workers.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; i++) {
+        m_workers.emplace_back(&JobSystem::worker_loop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+bool JobSystem::in_job() {
+    return t_in_job;
+}
+
+uint64_t JobSystem::order_key() const {
+    if (t_order_key != 0) {
+        return t_order_key;
+    }
+    return make_order_key(m_calls.load(std::memory_order_acquire), AFTER_CHUNKS);
+}
+
+size_t JobSystem::default_worker_count() {
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 0;
+}
+
+void JobSystem::run(size_t count, size_t min_chunk, Invoke invoke, void* ctx) {
+    if (count == 0) {
+        return;
+    }
+
+    min_chunk = std::max<size_t>(min_chunk, 1);
+    size_t max_chunks = (count + min_chunk - 1) / min_chunk;
+    size_t chunk_count = std::min(thread_count(), max_chunks);
+
+    // Still flagged as a job, so in_job() does not depend on the thread count
+    if (chunk_count <= 1 || t_in_job) {
+        bool was_in_job = t_in_job;
+        t_in_job = true;
+        invoke(ctx, 0, count);
+        t_in_job = was_in_job;
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(m_submit_mutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_invoke = invoke;
+        m_ctx = ctx;
+        m_count = count;
+        m_chunk_count = chunk_count;
+        m_chunk_size = (count + chunk_count - 1) / chunk_count;
+        m_pending = chunk_count - 1;
+        ++m_generation;
+        m_calls.fetch_add(1, std::memory_order_release);
+    }
+    m_wake.notify_all();
+
+    t_in_job = true;
+    run_chunk(0);
+    t_in_job = false;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+void JobSystem::run_chunk(size_t chunk) const {
+    size_t begin = chunk * m_chunk_size;
+    size_t end = std::min(begin + m_chunk_size, m_count);
+    if (begin < end) {
+        t_order_key = make_order_key(m_calls.load(std::memory_order_relaxed), chunk);
+        m_invoke(m_ctx, begin, end);
+        t_order_key = 0;
+    }
+}
+
+void JobSystem::worker_loop(size_t worker) {
+    t_in_job = true;
+    uint64_t seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) {
+                return;
+            }
+            seen = m_generation;
+
+            // Workers past the chunk count sit this job out
+            if (worker + 1 >= m_chunk_count) {
+                continue;
+            }
+        }
+
+        run_chunk(worker + 1);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            last = --m_pending == 0;
+        }
+        if (last) {
+            m_done.notify_one();
+        }
+    }
+}
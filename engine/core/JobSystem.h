@@ -0,0 +1,74 @@
+#ifndef GAME_JOBSYSTEM_H
+#define GAME_JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed pool of worker threads for data-parallel loops. parallel_for splits a
+// range into contiguous chunks, chunk 0 runs on the calling thread and chunk i
+// on worker i - 1, and the call returns once every chunk is done. The split only
+// depends on the range size and the thread count, so a given index always lands
+// on the same thread for the same input.
+class JobSystem {
+public:
+    explicit JobSystem(size_t worker_count = default_worker_count());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Calls fn(begin, end) over disjoint chunks of [0, count), each at least min_chunk long
+    template<typename Fn>
+    void parallel_for(size_t count, size_t min_chunk, Fn&& fn) {
+        auto invoke = [](void* ctx, size_t begin, size_t end) {
+            (*static_cast<std::remove_reference_t<Fn>*>(ctx))(begin, end);
+        };
+        run(count, min_chunk, invoke, &fn);
+    }
+
+    // Threads that take part in parallel_for, including the caller
+    size_t thread_count() const { return m_workers.size() + 1; }
+
+    static size_t default_worker_count();
+
+    // Where the calling thread is in this job system's sequence of parallel_for
+    // calls: (call, chunk) inside a chunk, and (latest call, after every chunk)
+    // outside one. Work sorted by it comes out in the order of a serial loop.
+    uint64_t order_key() const;
+
+    // True while the calling thread runs a parallel_for chunk
+    static bool in_job();
+
+private:
+    using Invoke = void (*)(void* ctx, size_t begin, size_t end);
+
+    void run(size_t count, size_t min_chunk, Invoke invoke, void* ctx);
+    void run_chunk(size_t chunk) const;
+    void worker_loop(size_t worker);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_submit_mutex; // Serializes parallel_for calls from different threads
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation = 0;
+    size_t m_pending = 0;
+    bool m_stop = false;
+    std::atomic<uint64_t> m_calls{0}; // parallel_for calls that went to the workers
+
+    // The job currently being run
+    Invoke m_invoke = nullptr;
+    void* m_ctx = nullptr;
+    size_t m_count = 0;
+    size_t m_chunk_size = 0;
+    size_t m_chunk_count = 0;
+};
+
+#endif //GAME_JOBSYSTEM_H
@@ -0,0 +1,108 @@
+#ifndef GAME_MPSCQUEUE_H
+#define GAME_MPSCQUEUE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free ring for many producer threads and one consumer thread.
+// Every cell carries a sequence number telling whose turn it is: a producer
+// claims a cell by bumping the tail with a CAS, writes the value and publishes
+// it by advancing the cell's sequence, and the consumer frees it the same way
+// one lap later. Neither side ever blocks the other, a full ring makes
+// try_push() fail instead.
+template<typename T>
+class MpscQueue {
+public:
+    // Capacity is rounded up to a power of two
+    explicit MpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+
+        m_cells = std::make_unique<Cell[]>(size);
+        m_mask = size - 1;
+        for (size_t i = 0; i < size; i++) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread. Returns false if the ring is full.
+    bool try_push(T value) {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. Returns false if the next value has not been
+    // published yet, values are always popped in the order they were claimed.
+    bool try_pop(T& out) {
+        Cell& cell = m_cells[m_head & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_head + 1) {
+            return false;
+        }
+
+        out = std::move(cell.value);
+        cell.value = T();
+        cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+        ++m_head;
+        return true;
+    }
+
+    // Consumer thread only. Pops at most capacity() values, so producers that
+    // keep pushing cannot hold the consumer here, and calls fn(T&) on each.
+    template<typename Fn>
+    size_t drain(Fn&& fn) {
+        T value;
+        size_t count = 0;
+        while (count < capacity() && try_pop(value)) {
+            fn(value);
+            ++count;
+        }
+        return count;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask = 0;
+
+    // Producers and the consumer write on separate cache lines
+    alignas(CACHE_LINE) std::atomic<size_t> m_tail{0};
+    alignas(CACHE_LINE) size_t m_head = 0;
+};
+
+#endif //GAME_MPSCQUEUE_H
@@ -0,0 +1,80 @@
+#ifndef GAME_PREFAB_H
+#define GAME_PREFAB_H
+
+#include "ComponentPool.h"
+#include "TypeId.h"
+#include <components/TransformComponent.hpp>
+#include <memory>
+#include <optional>
+#include <typeinfo>
+#include <vector>
+
+// A template entity: one value per component type, copied into every instance
+// by World::instantiate(). Resolve meshes and materials once when building the
+// prefab (see World::make_model), every instance then shares the references.
+class Prefab {
+public:
+    struct Entry {
+        uint32_t type_id = 0;
+        const char* type_name = "";
+        std::shared_ptr<const void> value;
+        std::unique_ptr<IComponentPool> (*create_pool)() = nullptr;
+        void (*insert)(IComponentPool& pool, const void* value, const Entity* entities, size_t count) = nullptr;
+    };
+
+    // Adds or replaces the value for T
+    template<typename T>
+    Prefab& set(T component) {
+        Entry entry;
+        entry.type_id = TypeId::of<T>();
+        entry.type_name = typeid(T).name();
+        entry.value = std::make_shared<const T>(std::move(component));
+        entry.create_pool = []() -> std::unique_ptr<IComponentPool> {
+            return std::make_unique<ComponentPool<T>>();
+        };
+        entry.insert = [](IComponentPool& pool, const void* value, const Entity* entities, size_t count) {
+            static_cast<ComponentPool<T>&>(pool).insert(entities, count, *static_cast<const T*>(value));
+        };
+
+        for (Entry& existing : m_entries) {
+            if (existing.type_id == entry.type_id) {
+                existing = std::move(entry);
+                return *this;
+            }
+        }
+        m_entries.push_back(std::move(entry));
+        return *this;
+    }
+
+    // The transform every instance starts with. Adds TransformComponent, whose
+    // values live in the transform streams rather than in the pool, so
+    // World::instantiate() writes this into the streams after the insert.
+    Prefab& set_transform(const Transform& transform) {
+        set(TransformComponent());
+        m_transform = transform;
+        return *this;
+    }
+
+    // Null unless set_transform() was called
+    const Transform* transform() const {
+        return m_transform ? &*m_transform : nullptr;
+    }
+
+    template<typename T>
+    const T* get() const {
+        for (const Entry& entry : m_entries) {
+            if (entry.type_id == TypeId::of<T>()) {
+                return static_cast<const T*>(entry.value.get());
+            }
+        }
+        return nullptr;
+    }
+
+    const std::vector<Entry>& entries() const { return m_entries; }
+
+private:
+    std::vector<Entry> m_entries;
+    std::optional<Transform> m_transform;
+};
+
+#endif //GAME_PREFAB_H
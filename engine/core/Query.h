@@ -0,0 +1,164 @@
+#ifndef GAME_QUERY_H
+#define GAME_QUERY_H
+
+#include "View.h"
+#include <array>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+template<typename Excluded, typename... Ts>
+class BasicQuery;
+
+// A view whose matches are cached. The entity list and component slots are
+// rebuilt only when one of the pools involved reports a new version(), i.e. an
+// add, remove or reorder since the last build. On a static scene iterating a
+// query costs no joins at all, only the walk over the cached arrays.
+//
+// Component values may be written freely, only structural changes go through
+// the rebuild. Change and tag filters are not cached, use a view for those.
+// Like a view, mutable terms are stamped as changed for every match visited
+// and const terms are not.
+template<typename... Es, typename... Ts>
+class BasicQuery<Exclude<Es...>, Ts...> {
+    template<typename T>
+    using PoolOf = ComponentPool<typename ViewTerm<T>::Component>;
+
+    using ViewType = BasicView<Exclude<Es...>, Ts...>;
+
+    static constexpr size_t ABSENT = std::numeric_limits<size_t>::max();
+
+public:
+    BasicQuery(JobSystem* jobs, const std::vector<Signature>* signatures, PoolOf<Ts>&... pools, ComponentPool<Es>&... excluded)
+        : m_jobs(jobs),
+          m_signatures(signatures),
+          m_pools(&pools...),
+          m_excluded(&excluded...),
+          m_versioned{ &pools..., &excluded... }
+    {}
+
+    // Calls fn(Entity, Ts&...) for every match, optional terms are passed as pointers
+    template<typename Fn>
+    void each(Fn&& fn) {
+        refresh();
+        for (size_t i = 0; i < m_entities.size(); i++) {
+            call(fn, i, std::index_sequence_for<Ts...>{});
+        }
+    }
+
+    // Parallel each() over the cached matches, see BasicView::par_each
+    template<typename Fn>
+    void par_each(Fn&& fn, size_t min_chunk = 256) {
+        refresh();
+        if (!m_jobs) {
+            each(fn);
+            return;
+        }
+
+        m_jobs->parallel_for(m_entities.size(), min_chunk, [this, &fn](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                call(fn, i, std::index_sequence_for<Ts...>{});
+            }
+        });
+    }
+
+    size_t size() {
+        refresh();
+        return m_entities.size();
+    }
+
+    const std::vector<Entity>& entities() {
+        refresh();
+        return m_entities;
+    }
+
+private:
+    static constexpr size_t POOL_COUNT = sizeof...(Ts) + sizeof...(Es);
+
+    JobSystem* m_jobs = nullptr;
+    const std::vector<Signature>* m_signatures = nullptr;
+    std::tuple<PoolOf<Ts>*...> m_pools;
+    std::tuple<ComponentPool<Es>*...> m_excluded;
+    std::array<const IComponentPool*, POOL_COUNT> m_versioned;
+    std::array<uint32_t, POOL_COUNT> m_versions{};
+    bool m_built = false;
+
+    std::vector<Entity> m_entities;
+    std::array<std::vector<size_t>, sizeof...(Ts)> m_slots; // Per term, ABSENT for a missing optional
+
+    void refresh() {
+        bool stale = !m_built;
+        for (size_t i = 0; i < POOL_COUNT && !stale; i++) {
+            stale = m_versioned[i]->version() != m_versions[i];
+        }
+        if (stale) {
+            rebuild(std::index_sequence_for<Ts...>{});
+        }
+    }
+
+    template<size_t... Is>
+    void rebuild(std::index_sequence<Is...>) {
+        m_entities.clear();
+        for (std::vector<size_t>& slots : m_slots) {
+            slots.clear();
+        }
+
+        ViewType view = std::apply([this](auto*... pools) {
+            return std::apply([this, pools...](auto*... excluded) {
+                return ViewType(m_jobs, m_signatures, *pools..., *excluded...);
+            }, m_excluded);
+        }, m_pools);
+
+        view.each_entity([this](Entity entity) {
+            m_entities.push_back(entity);
+            (m_slots[Is].push_back(slot_of<Is>(entity)), ...);
+        });
+
+        for (size_t i = 0; i < POOL_COUNT; i++) {
+            m_versions[i] = m_versioned[i]->version();
+        }
+        m_built = true;
+    }
+
+    template<size_t I>
+    size_t slot_of(Entity entity) const {
+        auto* pool = std::get<I>(m_pools);
+        return pool->contains(entity) ? pool->index_of(entity) : ABSENT;
+    }
+
+    // Yields what a view would for the cached slot, see BasicView
+    template<size_t I>
+    typename ViewTerm<std::tuple_element_t<I, std::tuple<Ts...>>>::Ref component(size_t idx) const {
+        using Term = ViewTerm<std::tuple_element_t<I, std::tuple<Ts...>>>;
+        size_t slot = m_slots[I][idx];
+        if constexpr (Term::optional) {
+            if (slot == ABSENT) {
+                return typename Term::Ref{};
+            }
+        }
+
+        auto* pool = std::get<I>(m_pools);
+        if constexpr (Term::writes) {
+            pool->mark_changed(slot);
+        }
+
+        if constexpr (std::is_pointer_v<typename Term::Ref>) {
+            return &pool->ref(slot);
+        } else if constexpr (Term::writes) {
+            return pool->ref(slot);
+        } else {
+            return std::as_const(*pool).ref(slot);
+        }
+    }
+
+    template<typename Fn, size_t... Is>
+    void call(Fn& fn, size_t idx, std::index_sequence<Is...>) const {
+        fn(m_entities[idx], component<Is>(idx)...);
+    }
+};
+
+template<typename... Ts>
+using Query = BasicQuery<Exclude<>, Ts...>;
+
+#endif //GAME_QUERY_H
@@ -0,0 +1,20 @@
+#ifndef GAME_RELOCATABLE_H
+#define GAME_RELOCATABLE_H
+
+#include <type_traits>
+
+// A type is trivially relocatable when moving an object to a new address and
+// abandoning the old bytes is the same as a memcpy. Pools of such types grow
+// with realloc and compact without calling move constructors or destructors.
+//
+// Trivially copyable types qualify automatically. Types that hold owning
+// handles which do not point back at themselves (std::shared_ptr, ...) can opt
+// in by specializing the trait next to their definition. Components that still
+// derive from IComponent have a vtable and take the regular path.
+template<typename T>
+struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+template<typename T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+#endif //GAME_RELOCATABLE_H
@@ -18,6 +18,21 @@
 #include "GLFW/glfw3.h"
 #include "glm/gtc/type_ptr.hpp"
 
+namespace {
+    // Draw order: models sharing a program, then a mesh, are submitted back to back
+    bool draw_order(const ModelComponent& a, const ModelComponent& b) {
+        uint16_t program_a = a.material ? a.material->program.idx : bgfx::kInvalidHandle;
+        uint16_t program_b = b.material ? b.material->program.idx : bgfx::kInvalidHandle;
+        if (program_a != program_b) {
+            return program_a < program_b;
+        }
+        return std::less<const MeshData*>()(a.mesh.get(), b.mesh.get());
+    }
+
+    // Up to this many out of place models are left to an insertion sort
+    constexpr size_t MAX_INSERTION_SORT_DESCENTS = 16;
+}
+
 Renderer::Renderer() : m_initialized(false) {}
 
 Renderer::~Renderer() {
@@ -111,9 +126,38 @@ void Renderer::draw_frame(World &world) {
     // Touch the view to ensure it's cleared even if nothing is drawn
     bgfx::touch(view_id);
 
-    // Iterate through model entities and render them
-    for (auto [e, model_transform, model] : world.view<TransformComponent, ModelComponent>()) {
-        Mat4 transform = model_transform.get_transform();
+    // Keep the models in draw order so consecutive draws share state. Sorting swaps
+    // pool slots, which invalidates cached queries, so it only runs after the group
+    // changed structurally. A few newcomers are put in place with an insertion sort,
+    // the first frame or a bulk load gets a full sort. Swapping the mesh or material
+    // of a model already in the group is picked up by the next structural change.
+    auto& models = world.group<TransformComponent, ModelComponent>();
+    if (!m_models_sorted || models.version() != m_models_version) {
+        size_t descents = 0;
+        const ModelComponent* previous = nullptr;
+        for (auto [e, model_transform, model] : std::as_const(models)) {
+            if (previous && draw_order(model, *previous)) {
+                ++descents;
+            }
+            previous = &model;
+        }
+
+        if (descents > MAX_INSERTION_SORT_DESCENTS) {
+            models.sort<ModelComponent>(draw_order);
+        } else if (descents > 0) {
+            models.sort_insertion<ModelComponent>(draw_order);
+        }
+
+        m_models_sorted = true;
+        m_models_version = models.version();
+    }
+
+    // Iterate through model entities and render them. The owning group keeps both pools
+    // co-sorted, so this walks the models and the transform streams in step without
+    // any per-entity lookups. Both walks only read, so they go through the const
+    // group and leave the changed ticks alone.
+    for (auto [e, model_transform, model] : std::as_const(models)) {
+        const Mat4& transform = model_transform.get_transform();
         bgfx::setTransform(glm::value_ptr(transform));
         bgfx::setVertexBuffer(0, model.mesh->vbh);
         bgfx::setIndexBuffer(model.mesh->ibh);
@@ -24,6 +24,10 @@ private:
     int32_t m_width = 0;
     int32_t m_height = 0;
     double m_last_dt = 0.0;
+
+    // Version of the model group when it was last sorted into draw order
+    bool m_models_sorted = false;
+    uint32_t m_models_version = 0;
 };
 
 #endif //GAME_RENDERER_H
\ No newline at end of file
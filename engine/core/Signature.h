@@ -0,0 +1,46 @@
+#ifndef GAME_SIGNATURE_H
+#define GAME_SIGNATURE_H
+
+#include "TypeId.h"
+#include <bitset>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <typeinfo>
+
+// Set of component types, bit TypeId::of<T>() stands for T. Testing an entity
+// against a query is a single AND and compare. Projects with more component
+// types raise the limit by defining GAME_MAX_COMPONENT_TYPES.
+#ifndef GAME_MAX_COMPONENT_TYPES
+#define GAME_MAX_COMPONENT_TYPES 64
+#endif
+
+constexpr size_t MAX_SIGNATURE_TYPES = GAME_MAX_COMPONENT_TYPES;
+
+using Signature = std::bitset<MAX_SIGNATURE_TYPES>;
+
+// Checked in every build, an id past the limit would make bitset::set throw
+// std::out_of_range somewhere far from the type that caused it
+inline size_t signature_bit(uint32_t type_id, const char* type_name = "<unknown>") {
+    if (type_id >= MAX_SIGNATURE_TYPES) {
+        std::cerr << "Component type " << type_name << " does not fit in a signature, "
+                  << MAX_SIGNATURE_TYPES << " component types are in use already. "
+                  << "Raise GAME_MAX_COMPONENT_TYPES." << std::endl;
+        std::abort();
+    }
+    return type_id;
+}
+
+template<typename T>
+size_t signature_bit() {
+    return signature_bit(TypeId::of<T>(), typeid(T).name());
+}
+
+template<typename... Ts>
+Signature signature_of() {
+    Signature signature;
+    (signature.set(signature_bit<Ts>()), ...);
+    return signature;
+}
+
+#endif //GAME_SIGNATURE_H
@@ -0,0 +1,21 @@
+#include "SparseArray.h"
+#include <algorithm>
+
+size_t SparseArray::page_count() const {
+    return static_cast<size_t>(std::count_if(m_pages.begin(), m_pages.end(),
+        [](const std::unique_ptr<Entity[]>& page) { return page != nullptr; }));
+}
+
+Entity* SparseArray::page_for(uint32_t index) {
+    size_t page = index / PAGE_SIZE;
+    if (page >= m_pages.size()) {
+        m_pages.resize(page + 1);
+    }
+
+    if (!m_pages[page]) {
+        m_pages[page] = std::make_unique<Entity[]>(PAGE_SIZE);
+        std::fill_n(m_pages[page].get(), PAGE_SIZE, INVALID);
+    }
+
+    return m_pages[page].get();
+}
@@ -0,0 +1,36 @@
+#ifndef GAME_SPARSEARRAY_H
+#define GAME_SPARSEARRAY_H
+
+#include "Types.h"
+#include <limits>
+#include <memory>
+#include <vector>
+
+// Maps entity indices to dense slots. Storage is split into 4 KiB pages that are
+// only allocated once an index inside them is written, so memory follows the
+// ranges of ids actually in use instead of the highest id ever handed out.
+class SparseArray {
+public:
+    static constexpr Entity INVALID = std::numeric_limits<Entity>::max();
+    static constexpr size_t PAGE_BYTES = 4096;
+    static constexpr size_t PAGE_SIZE = PAGE_BYTES / sizeof(Entity);
+
+    Entity get(uint32_t index) const {
+        size_t page = index / PAGE_SIZE;
+        return page < m_pages.size() && m_pages[page] ? m_pages[page][index % PAGE_SIZE] : INVALID;
+    }
+
+    void set(uint32_t index, Entity value) {
+        page_for(index)[index % PAGE_SIZE] = value;
+    }
+
+    // Pages currently allocated, for memory accounting
+    size_t page_count() const;
+
+private:
+    Entity* page_for(uint32_t index);
+
+    std::vector<std::unique_ptr<Entity[]>> m_pages;
+};
+
+#endif //GAME_SPARSEARRAY_H
@@ -17,6 +17,9 @@ public:
     static void add(void(*fn)(Args..., State&), int priority = 0)  { reg().add<State>(fn, priority); }
     static void finalize() { reg().finalize(); }
     static void fire(Args... args) { reg().fire(args...); }
+    // Calls before(priority) ahead of each callback
+    template<typename Before>
+    static void fire_each(Before before, Args... args) { reg().fire_each(before, args...); }
     static std::size_t size() { return reg().size(); }
 
 // Make helper classes public so std::make_unique can access them from outside _Event's scope.
@@ -90,6 +93,14 @@ private:
             }
         }
 
+        template<typename Before>
+        void fire_each(Before& before, Args... args) {
+            for (auto& e : m_entries) {
+                before(e->priority());
+                e->call(args...);
+            }
+        }
+
         std::size_t size() const {
             return m_entries.size();
         }
@@ -130,12 +141,16 @@ public:
         OnUpdate::finalize();
     }
 
+    // Commands a system records are stamped with its priority, which is the
+    // order execute_commands() runs them in
     static void fire_startup(World& world) {
-        OnStartup::fire(world);
+        OnStartup::fire_each([&world](int priority) { world.set_command_priority(priority); }, world);
+        world.set_command_priority(0);
     }
 
     static void fire_update(World& world, float dt) {
-        OnUpdate::fire(world, dt);
+        OnUpdate::fire_each([&world](int priority) { world.set_command_priority(priority); }, world, dt);
+        world.set_command_priority(0);
     }
 };
 
@@ -0,0 +1,9 @@
+#include "TagSet.h"
+
+size_t TagSet::count() const {
+    size_t count = 0;
+    for (uint64_t word : m_words) {
+        count += popcount(word);
+    }
+    return count;
+}
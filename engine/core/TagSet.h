@@ -0,0 +1,55 @@
+#ifndef GAME_TAGSET_H
+#define GAME_TAGSET_H
+
+#include "Types.h"
+#include "Bits.h"
+#include <cstdint>
+#include <vector>
+
+// Storage for a zero-size tag component: one bit per entity index. 100k
+// entities take about 12 KiB, and scans skip 64 untagged entities per word.
+class TagSet {
+public:
+    void set(uint32_t index) {
+        size_t word = index / 64;
+        if (word >= m_words.size()) {
+            m_words.resize(word + 1, 0);
+        }
+
+        m_words[word] |= uint64_t(1) << (index % 64);
+    }
+
+    void reset(uint32_t index) {
+        size_t word = index / 64;
+        if (word < m_words.size()) {
+            m_words[word] &= ~(uint64_t(1) << (index % 64));
+        }
+    }
+
+    bool test(uint32_t index) const {
+        size_t word = index / 64;
+        return word < m_words.size() && (m_words[word] >> (index % 64)) & 1;
+    }
+
+    // Calls fn(index) for every set bit in ascending order
+    template<typename Fn>
+    void each(Fn&& fn) const {
+        for (size_t word = 0; word < m_words.size(); word++) {
+            uint64_t bits = m_words[word];
+            while (bits) {
+                fn(static_cast<uint32_t>(word * 64 + count_trailing_zeros(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    // Number of set bits, one popcount per word
+    size_t count() const;
+
+    void clear() { m_words.clear(); }
+
+private:
+    std::vector<uint64_t> m_words;
+};
+
+#endif //GAME_TAGSET_H
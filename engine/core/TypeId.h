@@ -0,0 +1,28 @@
+#ifndef GAME_TYPEID_H
+#define GAME_TYPEID_H
+
+#include <atomic>
+#include <cstdint>
+
+// Small dense ids per type, handed out in order of first use. Ids are stable for
+// the lifetime of the program and can index flat arrays directly. Every Family
+// counts separately, so tags or resources do not use up component ids.
+template<typename Family>
+class FamilyTypeId {
+public:
+    template<typename T>
+    static uint32_t of() {
+        static const uint32_t id = s_next++;
+        return id;
+    }
+
+private:
+    inline static std::atomic<uint32_t> s_next{0};
+};
+
+using TypeId = FamilyTypeId<struct ComponentFamily>;
+using TagTypeId = FamilyTypeId<struct TagFamily>;
+using ResourceTypeId = FamilyTypeId<struct ResourceFamily>;
+using QueryTypeId = FamilyTypeId<struct QueryFamily>;
+
+#endif //GAME_TYPEID_H
@@ -16,6 +16,32 @@ using Mat4 = glm::mat4;
 
 using Entity = uint32_t;
 
+// Entity handles pack a slot index in the low bits and a generation in the high bits.
+// The generation is bumped whenever a slot is recycled, so stale handles stop matching.
+constexpr uint32_t ENTITY_INDEX_BITS = 20;
+constexpr uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+constexpr uint32_t ENTITY_GENERATION_MASK = (1u << (32 - ENTITY_INDEX_BITS)) - 1;
+
+// Index 0 is never handed out, so a zero handle means "no entity"
+constexpr Entity NULL_ENTITY = 0;
+
+// Number of entity slots addressable by a handle, slot 0 included. This is the
+// only cap on live entities, about a million. More would take index bits away
+// from the generation and make stale handles match again sooner.
+constexpr size_t MAX_ENTITIES = size_t(ENTITY_INDEX_MASK) + 1;
+
+constexpr uint32_t entity_index(Entity entity) {
+    return entity & ENTITY_INDEX_MASK;
+}
+
+constexpr uint32_t entity_generation(Entity entity) {
+    return entity >> ENTITY_INDEX_BITS;
+}
+
+constexpr Entity make_entity(uint32_t index, uint32_t generation) {
+    return (generation << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK);
+}
+
 enum class ProjectionType {
     Perspective,
     Orthographic
@@ -0,0 +1,401 @@
+#ifndef GAME_VIEW_H
+#define GAME_VIEW_H
+
+#include "ComponentPool.h"
+#include "JobSystem.h"
+#include "TagSet.h"
+#include "Signature.h"
+#include <array>
+#include <cassert>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Components an entity must not have, e.g. world.view<A, B>(exclude<C>)
+template<typename... Ts>
+struct Exclude {};
+
+template<typename... Ts>
+inline constexpr Exclude<Ts...> exclude{};
+
+// View term for a component an entity may or may not have. It is yielded as a
+// pointer that is null when the component is absent, and never drives iteration.
+// Components kept in columns yield their handle instead, empty when absent.
+template<typename T>
+struct Optional {};
+
+// A term T is yielded as T& and counts as a write, a term const T (or
+// Optional<const T>) is yielded read only and leaves the changed tick alone.
+// Components kept in columns are yielded as their handle, see
+// ComponentColumns.h, e.g. TransformComponent as a TransformRef.
+template<typename T>
+struct ViewTerm {
+    using Component = std::remove_const_t<T>;
+    using Ref = component_ref_t<T>;
+    static constexpr bool optional = false;
+    static constexpr bool writes = !std::is_const_v<T>;
+};
+
+template<typename T>
+struct ViewTerm<Optional<T>> {
+    using Component = std::remove_const_t<T>;
+    using Ref = std::conditional_t<std::is_reference_v<component_ref_t<T>>, T*, component_ref_t<T>>;
+    static constexpr bool optional = true;
+    static constexpr bool writes = !std::is_const_v<T>;
+};
+
+template<typename Excluded, typename... Ts>
+class BasicView;
+
+// Iterates every entity that has all of the required Ts and none of the
+// excluded types. The smallest required pool drives the iteration and every
+// other check is a sparse array lookup, so the cost is proportional to the
+// rarest required component.
+//
+// changed<T>() and added<T>() narrow the view to entities whose T was changed or
+// added during the last completed frame window, see ComponentPool. Every entity
+// a view hands a mutable T& (or T*) to has its T stamped as changed, whether or
+// not fn writes to it. Systems that only read T should ask for const T, or a
+// view over changed<T>() keeps matching the entities it visits frame after
+// frame.
+//
+// When the view is given the World's per-entity signatures, membership in
+// every required and excluded pool is one mask test instead of a lookup per pool.
+//
+// with_tag() and without_tag() filter on tag bitsets. When a required tag is
+// rarer than the driving pool, each() walks the tag's set bits instead.
+template<typename... Es, typename... Ts>
+class BasicView<Exclude<Es...>, Ts...> {
+    static_assert(sizeof...(Ts) > 0, "A view needs at least one component type");
+    static_assert((!ViewTerm<Ts>::optional || ...), "A view needs at least one required component type");
+
+    template<typename T>
+    using PoolOf = ComponentPool<typename ViewTerm<T>::Component>;
+
+    using Tuple = std::tuple<Entity, typename ViewTerm<Ts>::Ref...>;
+
+public:
+    BasicView(JobSystem* jobs, const std::vector<Signature>* signatures, PoolOf<Ts>&... pools, ComponentPool<Es>&... excluded)
+        : m_pools(&pools...),
+          m_excluded(&excluded...),
+          m_jobs(jobs),
+          m_signatures(signatures)
+    {
+        if (m_signatures) {
+            m_required = (term_signature<Ts>() | ... | Signature());
+            m_mask = m_required | signature_of<Es...>();
+        }
+
+        constexpr size_t NOT_A_DRIVER = std::numeric_limits<size_t>::max();
+        std::array<size_t, sizeof...(Ts)> sizes = { (ViewTerm<Ts>::optional ? NOT_A_DRIVER : pools.size())... };
+        for (size_t i = 1; i < sizes.size(); i++) {
+            if (sizes[i] < sizes[m_driver]) {
+                m_driver = i;
+            }
+        }
+
+        const std::vector<Entity>* entities[] = { &pools.entities()... };
+        const SparseArray* sparse[] = { &pools.sparse()... };
+        m_entities = entities[m_driver]->data();
+        m_count = entities[m_driver]->size();
+        m_sparse = sparse[m_driver];
+    }
+
+    class Iter {
+    public:
+        const BasicView* view{};
+        size_t idx{};
+
+        void skip_invalid() {
+            while (idx < view->m_count && !view->valid(view->m_entities[idx]))
+                ++idx;
+        }
+
+        Tuple operator*() const {
+            return view->get(idx, std::index_sequence_for<Ts...>{});
+        }
+
+        Iter& operator++() {
+            ++idx;
+            skip_invalid();
+            return *this;
+        }
+
+        bool operator!=(const Iter& o) const {
+            return idx != o.idx;
+        }
+    };
+
+    Iter begin() const {
+        Iter it{this, 0};
+        it.skip_invalid();
+        return it;
+    }
+
+    Iter end() const {
+        return Iter{this, m_count};
+    }
+
+    // Calls fn(Entity, Ts&...) for every matching entity, optional terms are passed as pointers
+    template<typename Fn>
+    void each(Fn&& fn) const {
+        visit([this, &fn](size_t idx) {
+            std::apply(fn, get(idx, std::index_sequence_for<Ts...>{}));
+        });
+    }
+
+    // Calls fn(Entity) for every matching entity without touching its components
+    template<typename Fn>
+    void each_entity(Fn&& fn) const {
+        visit([this, &fn](size_t idx) {
+            fn(m_entities[idx]);
+        });
+    }
+
+    // Parallel each(). The driving pool's dense range is split into contiguous
+    // chunks that run on the job system, and every entity is visited by exactly
+    // one thread. fn may mutate the non-const terms it is handed and submit world
+    // commands, but must not add or remove components directly.
+    template<typename Fn>
+    void par_each(Fn&& fn, size_t min_chunk = 256) const {
+        if (!m_jobs) {
+            each(fn);
+            return;
+        }
+
+        m_jobs->parallel_for(m_count, min_chunk, [this, &fn](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                if (valid(m_entities[i])) {
+                    std::apply(fn, get(i, std::index_sequence_for<Ts...>{}));
+                }
+            }
+        });
+    }
+
+    // Upper bound on the number of matches, the size of the driving pool
+    size_t size_hint() const { return m_count; }
+
+    template<typename T>
+    BasicView changed() const {
+        static_assert(index_of<T>() < sizeof...(Ts), "changed<T>() needs T to be part of the view");
+        BasicView view = *this;
+        view.m_changed_filter |= 1u << index_of<T>();
+        return view;
+    }
+
+    template<typename T>
+    BasicView added() const {
+        static_assert(index_of<T>() < sizeof...(Ts), "added<T>() needs T to be part of the view");
+        BasicView view = *this;
+        view.m_added_filter |= 1u << index_of<T>();
+        return view;
+    }
+
+    BasicView with_tag(const TagSet& tags) const {
+        assert(m_with_count < MAX_TAG_FILTERS && "Too many tag filters on one view!");
+        BasicView view = *this;
+        view.m_with_tags[view.m_with_count++] = &tags;
+        return view;
+    }
+
+    BasicView without_tag(const TagSet& tags) const {
+        assert(m_without_count < MAX_TAG_FILTERS && "Too many tag filters on one view!");
+        BasicView view = *this;
+        view.m_without_tags[view.m_without_count++] = &tags;
+        return view;
+    }
+
+private:
+    static constexpr size_t MAX_TAG_FILTERS = 4;
+
+    std::tuple<PoolOf<Ts>*...> m_pools;
+    std::tuple<ComponentPool<Es>*...> m_excluded;
+    JobSystem* m_jobs = nullptr;
+    const std::vector<Signature>* m_signatures = nullptr; // Indexed by entity_index()
+    Signature m_required;                                  // Bits of the required terms
+    Signature m_mask;                                      // Bits of the required and excluded terms
+    const Entity* m_entities = nullptr;
+    const SparseArray* m_sparse = nullptr;
+    size_t m_count = 0;
+    size_t m_driver = 0;
+    uint32_t m_changed_filter = 0; // Bit I set: component I must have changed in the last window
+    uint32_t m_added_filter = 0;   // Bit I set: component I must have been added in the last window
+    std::array<const TagSet*, MAX_TAG_FILTERS> m_with_tags{};
+    std::array<const TagSet*, MAX_TAG_FILTERS> m_without_tags{};
+    size_t m_with_count = 0;
+    size_t m_without_count = 0;
+
+    // Optional terms do not constrain the signature
+    template<typename T>
+    static Signature term_signature() {
+        if constexpr (ViewTerm<T>::optional) {
+            return Signature();
+        } else {
+            return signature_of<typename ViewTerm<T>::Component>();
+        }
+    }
+
+    template<typename T>
+    static constexpr size_t index_of() {
+        constexpr bool matches[] = { std::is_same_v<std::remove_const_t<T>, typename ViewTerm<Ts>::Component>... };
+        for (size_t i = 0; i < sizeof...(Ts); i++) {
+            if (matches[i]) {
+                return i;
+            }
+        }
+        return sizeof...(Ts);
+    }
+
+    // Calls fn(idx) with the driving pool's dense index of every match
+    template<typename Fn>
+    void visit(Fn&& fn) const {
+        size_t tagged = 0;
+        if (const TagSet* tags = rarest_tag(tagged); tags && tagged < m_count) {
+            tags->each([this, &fn](uint32_t index) {
+                Entity slot = m_sparse->get(index);
+                if (slot != SparseArray::INVALID && valid(m_entities[slot])) {
+                    fn(static_cast<size_t>(slot));
+                }
+            });
+            return;
+        }
+
+        for (size_t i = 0; i < m_count; i++) {
+            if (valid(m_entities[i])) {
+                fn(i);
+            }
+        }
+    }
+
+    // The required tag with the fewest set bits, or null without tag filters
+    const TagSet* rarest_tag(size_t& count) const {
+        const TagSet* rarest = nullptr;
+        for (size_t i = 0; i < m_with_count; i++) {
+            size_t tagged = m_with_tags[i]->count();
+            if (!rarest || tagged < count) {
+                rarest = m_with_tags[i];
+                count = tagged;
+            }
+        }
+        return rarest;
+    }
+
+    bool tags_match(Entity entity) const {
+        uint32_t index = entity_index(entity);
+        for (size_t i = 0; i < m_with_count; i++) {
+            if (!m_with_tags[i]->test(index)) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < m_without_count; i++) {
+            if (m_without_tags[i]->test(index)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool valid(Entity entity) const {
+        if (!tags_match(entity)) {
+            return false;
+        }
+
+        if (m_signatures) {
+            uint32_t index = entity_index(entity);
+            if (index >= m_signatures->size() || ((*m_signatures)[index] & m_mask) != m_required) {
+                return false;
+            }
+        } else if (!has_components(entity)) {
+            return false;
+        }
+
+        return !(m_changed_filter | m_added_filter) || filters_match(entity, std::index_sequence_for<Ts...>{});
+    }
+
+    bool has_components(Entity entity) const {
+        bool excluded = std::apply([entity](auto*... pools) {
+            return (pools->contains(entity) || ...);
+        }, m_excluded);
+
+        return !excluded && has_components(entity, std::index_sequence_for<Ts...>{});
+    }
+
+    template<size_t... Is>
+    bool has_components(Entity entity, std::index_sequence<Is...>) const {
+        return ((ViewTerm<std::tuple_element_t<Is, std::tuple<Ts...>>>::optional || std::get<Is>(m_pools)->contains(entity)) && ...);
+    }
+
+    template<size_t... Is>
+    bool filters_match(Entity entity, std::index_sequence<Is...>) const {
+        return (filter_matches<Is>(entity) && ...);
+    }
+
+    // A change filter on an optional term also requires the component to be present
+    template<size_t I>
+    bool filter_matches(Entity entity) const {
+        bool changed = m_changed_filter & (1u << I);
+        bool added = m_added_filter & (1u << I);
+        if (!changed && !added) {
+            return true;
+        }
+
+        auto* pool = std::get<I>(m_pools);
+        if (!pool->contains(entity)) {
+            return false;
+        }
+        if (changed && !pool->changed_since(entity, pool->last_sync_tick())) {
+            return false;
+        }
+        if (added && !pool->added_since(entity, pool->last_sync_tick())) {
+            return false;
+        }
+        return true;
+    }
+
+    // The driving pool is read at the current dense index, the others through
+    // their sparse arrays. Read only terms go through the const pool.
+    template<size_t I>
+    decltype(auto) component(size_t idx, Entity entity) const {
+        using Term = ViewTerm<std::tuple_element_t<I, std::tuple<Ts...>>>;
+        auto* pool = std::get<I>(m_pools);
+        if constexpr (Term::writes) {
+            return access<Term>(*pool, idx, entity, I == m_driver);
+        } else {
+            return access<Term>(std::as_const(*pool), idx, entity, I == m_driver);
+        }
+    }
+
+    template<typename Term, typename Pool>
+    static typename Term::Ref access(Pool& pool, size_t idx, Entity entity, bool driver) {
+        if (!driver) {
+            if constexpr (Term::optional) {
+                if (!pool.contains(entity)) {
+                    return typename Term::Ref{};
+                }
+            }
+            idx = pool.index_of(entity);
+        }
+
+        if constexpr (Term::writes) {
+            pool.mark_changed(idx);
+        }
+
+        if constexpr (std::is_pointer_v<typename Term::Ref>) {
+            return &pool.ref(idx);
+        } else {
+            return pool.ref(idx);
+        }
+    }
+
+    template<size_t... Is>
+    Tuple get(size_t idx, std::index_sequence<Is...>) const {
+        Entity entity = m_entities[idx];
+        return Tuple{ entity, component<Is>(idx, entity)... };
+    }
+};
+
+template<typename... Ts>
+using View = BasicView<Exclude<>, Ts...>;
+
+#endif //GAME_VIEW_H
@@ -1,52 +1,517 @@
 #include "World.h"
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 
+namespace {
+    struct RotateCommand {
+        Vec3 axis;
+        float angle_rad;
+    };
+
+    std::atomic<uint64_t> s_next_world_id{0};
+
+    // Writes that only touch the target entity's own transform
+    bool is_transform_write(CommandOp op) {
+        switch (op) {
+            case CommandOp::SetPosition:
+            case CommandOp::SetRotation:
+            case CommandOp::SetScale:
+            case CommandOp::Rotate:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Commands that can read transforms, or change which entities have one or
+    // where they sit in the hierarchy. Transform writes are never moved across them
+    bool is_transform_barrier(CommandOp op) {
+        switch (op) {
+            case CommandOp::DestroyEntity:
+            case CommandOp::SetParent:
+            case CommandOp::Invoke:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Bit in CoalesceSlot::fields of the commands that only overwrite a field,
+    // 0 for every other command
+    uint8_t overwritten_field(CommandOp op) {
+        switch (op) {
+            case CommandOp::SetPosition: return 1 << 0;
+            case CommandOp::SetRotation: return 1 << 1;
+            case CommandOp::SetScale:    return 1 << 2;
+            default:                     return 0;
+        }
+    }
+}
+
+thread_local std::vector<std::pair<uint64_t, World::ThreadCommands*>> World::t_thread_commands;
+
 World::World()
-    :   m_active_camera(0),
-        m_command_queue(std::make_unique<CommandQueue>()),
-        m_entity_pool(std::make_unique<EntityPool>(MAX_ENTITIES)),
-        m_entity_sparse_set(std::make_unique<EntitySparseSet>(MAX_ENTITIES)),
+    :   m_active_camera(NULL_ENTITY),
+        m_id(s_next_world_id++),
+        m_job_system(std::make_unique<JobSystem>()),
+        m_entity_pool(std::make_unique<EntityPool>()),
+        m_entity_sparse_set(std::make_unique<EntitySparseSet>()),
+        m_hierarchy(std::make_unique<Hierarchy>()),
         m_input_manager(std::make_unique<InputManager>()),
         m_mesh_manager(std::make_unique<MeshManager>()),
-        m_material_manager(std::make_unique<MaterialManager>()),
-
-        m_transform_component_pool(std::make_unique<ComponentPool<TransformComponent>>()),
-        m_camera_component_pool(std::make_unique<ComponentPool<CameraComponent>>()),
-        m_model_component_pool(std::make_unique<ComponentPool<ModelComponent>>())
+        m_material_manager(std::make_unique<MaterialManager>())
 {}
 
 // =================== General World Interface =================== //
 Entity World::create_entity() {
     Entity entity = m_entity_pool->create();
-    m_command_queue->submit([this, entity] {
-        m_entity_sparse_set->insert(entity);
-    });
+    submit(CommandOp::CreateEntities, &entity, size_t(1));
 
     return entity;
 }
 
+// Appends the new entities to out and registers them all with one command
+void World::create_entities(size_t count, std::vector<Entity>& out) {
+    size_t first = out.size();
+    m_entity_pool->create(count, out);
+
+    submit(CommandOp::CreateEntities, static_cast<const Entity*>(out.data() + first), count);
+}
+
+void World::destroy_entity(Entity entity) {
+    submit(CommandOp::DestroyEntity, entity);
+}
+
+bool World::is_alive(Entity entity) const {
+    return m_entity_pool->is_alive(entity);
+}
+
 void World::execute_commands() {
-    for (auto cmd : m_command_queue->drain()) {
-        cmd();
+    // Work posted by other threads, commands it records run in this sync too
+    m_posted.drain([](std::function<void()>& fn) {
+        fn();
+    });
+
+    // Flip every thread to its other buffer, commands recorded while these run
+    // go there and run next sync
+    m_merged_commands.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_command_mutex);
+        for (auto& thread : m_thread_commands) {
+            CommandBuffer& executing = thread->buffers[thread->recording];
+            std::vector<std::pair<size_t, uint64_t>>& runs = thread->order_runs[thread->recording];
+            thread->recording ^= 1;
+
+            size_t record = 0;
+            size_t run = 0;
+            executing.for_each_record([&](CommandHeader& header, void* payload) {
+                if (run + 1 < runs.size() && runs[run + 1].first == record) {
+                    ++run;
+                }
+                m_merged_commands.push_back({ header.priority, runs[run].second, &header, payload });
+                ++record;
+            });
+            runs.clear();
+        }
+    }
+
+    // The refs are in thread order, so a stable sort on (priority, order key)
+    // gives (priority, order key, thread, sequence)
+    auto by_key = [](const CommandRef& a, const CommandRef& b) {
+        return a.priority != b.priority ? a.priority < b.priority : a.order < b.order;
+    };
+    if (!std::is_sorted(m_merged_commands.begin(), m_merged_commands.end(), by_key)) {
+        std::stable_sort(m_merged_commands.begin(), m_merged_commands.end(), by_key);
+    }
+
+    coalesce_commands();
+
+    // Commands run in the merged order, except that the transform writes between
+    // two barriers go to the job system in one batch once there are enough of them.
+    // The other commands in such a segment touch no transforms, so they run first.
+    auto apply = [this](const CommandHeader& header, const void* payload) {
+        dispatch(header, payload);
+    };
+    for (size_t i = 0; i < m_merged_commands.size();) {
+        size_t end = i;
+        size_t writes = 0;
+        while (end < m_merged_commands.size() && !is_transform_barrier(m_merged_commands[end].header->op)) {
+            writes += is_transform_write(m_merged_commands[end].header->op);
+            ++end;
+        }
+
+        bool parallel = writes >= PARALLEL_WRITE_THRESHOLD && m_job_system->thread_count() > 1;
+        for (size_t k = i; k < end; k++) {
+            if (!parallel || !is_transform_write(m_merged_commands[k].header->op)) {
+                dispatch(*m_merged_commands[k].header, m_merged_commands[k].payload);
+            }
+        }
+        if (parallel) {
+            apply_transform_writes(i, end);
+        }
+
+        if (end < m_merged_commands.size()) {
+            CommandBuffer::run(*m_merged_commands[end].header, m_merged_commands[end].payload, apply);
+        }
+        i = end + 1;
+    }
+    m_merged_commands.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(m_command_mutex);
+        for (auto& thread : m_thread_commands) {
+            thread->buffers[thread->recording ^ 1].reset();
+        }
+    }
+
+    propagate_transforms();
+    update_transforms();
+
+    // Close the frame's change window, later writes are stamped with the next tick
+    ++m_tick;
+    for (auto& pool : m_pools) {
+        if (pool) {
+            pool->set_tick(m_tick);
+        }
+    }
+}
+
+size_t World::coalesced_command_count() const {
+    return m_coalesced_commands;
+}
+
+// Walks the merged commands from the back and drops every transform write
+// that a later write to the same entity and field replaces before anything
+// reads it. Readers are barriers: Rotate reads the rotation, SetParent and
+// DestroyEntity the whole transform, and an Invoke may read anything. Writes
+// to a parent are never dropped, a child's write converts its world transform
+// against the parent's at that point.
+void World::coalesce_commands() {
+    for (const CommandRef& command : m_merged_commands) {
+        if (command.header->op == CommandOp::SetParent) {
+            Entity parent = payload_as<Entity>(command.payload);
+            if (parent != NULL_ENTITY) {
+                CoalesceSlot& slot = coalesce_slot(parent);
+                slot.entity = parent;
+                slot.parent = true;
+            }
+        }
+    }
+
+    size_t dropped = 0;
+    for (size_t i = m_merged_commands.size(); i-- > 0;) {
+        const CommandHeader& header = *m_merged_commands[i].header;
+
+        if (uint8_t field = overwritten_field(header.op)) {
+            if (m_hierarchy->first_child(header.entity) != NULL_ENTITY) {
+                continue;
+            }
+
+            CoalesceSlot& slot = coalesce_slot(header.entity);
+            if (slot.entity != header.entity) {
+                // Another handle of this slot is tracked, keep both to be safe
+                if (slot.fields != 0 || slot.parent) {
+                    continue;
+                }
+                slot.entity = header.entity;
+            }
+
+            if (slot.parent) {
+                continue;
+            }
+
+            if (slot.fields & field) {
+                m_merged_commands[i].header = nullptr;
+                ++dropped;
+            } else {
+                slot.fields |= field;
+            }
+            continue;
+        }
+
+        uint32_t index = entity_index(header.entity);
+        CoalesceSlot* slot = index < m_coalesce_slots.size() ? &m_coalesce_slots[index] : nullptr;
+
+        switch (header.op) {
+            case CommandOp::Rotate:
+                if (slot) {
+                    slot->fields &= ~overwritten_field(CommandOp::SetRotation);
+                }
+                break;
+            case CommandOp::SetParent:
+            case CommandOp::DestroyEntity:
+                if (slot) {
+                    slot->fields = 0;
+                }
+                break;
+            case CommandOp::Invoke:
+                for (uint32_t touched : m_coalesce_touched) {
+                    m_coalesce_slots[touched].fields = 0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    for (uint32_t index : m_coalesce_touched) {
+        m_coalesce_slots[index] = CoalesceSlot();
+    }
+    m_coalesce_touched.clear();
+
+    if (dropped > 0) {
+        m_merged_commands.erase(
+            std::remove_if(m_merged_commands.begin(), m_merged_commands.end(),
+                [](const CommandRef& command) { return command.header == nullptr; }),
+            m_merged_commands.end());
+        m_coalesced_commands += dropped;
+    }
+}
+
+// Applies the transform writes in m_merged_commands[begin, end) on the job
+// system. Writes are bucketed by the root of their entity's hierarchy: a
+// child's write reads its parent's transform, so a whole tree goes to one
+// thread and keeps its order there.
+void World::apply_transform_writes(size_t begin, size_t end) {
+    size_t partitions = m_job_system->thread_count();
+    m_partition_offsets.assign(partitions + 1, 0);
+    m_partition_of.resize(end - begin);
+
+    for (size_t i = begin; i < end; i++) {
+        if (!is_transform_write(m_merged_commands[i].header->op)) {
+            continue;
+        }
+
+        Entity root = m_merged_commands[i].header->entity;
+        for (Entity parent = m_hierarchy->parent(root); parent != NULL_ENTITY; parent = m_hierarchy->parent(root)) {
+            root = parent;
+        }
+
+        uint32_t partition = static_cast<uint32_t>(entity_index(root) % partitions);
+        m_partition_of[i - begin] = partition;
+        ++m_partition_offsets[partition + 1];
+    }
+
+    for (size_t p = 0; p < partitions; p++) {
+        m_partition_offsets[p + 1] += m_partition_offsets[p];
+    }
+
+    // Stable scatter, each bucket keeps the merged order
+    m_partition_cursor.assign(m_partition_offsets.begin(), m_partition_offsets.end() - 1);
+    m_partitioned_commands.resize(m_partition_offsets[partitions]);
+    for (size_t i = begin; i < end; i++) {
+        if (is_transform_write(m_merged_commands[i].header->op)) {
+            m_partitioned_commands[m_partition_cursor[m_partition_of[i - begin]]++] = &m_merged_commands[i];
+        }
+    }
+
+    // Created here so the workers only ever look the pool up
+    pool<TransformComponent>();
+
+    m_job_system->parallel_for(partitions, 1, [this](size_t first, size_t last) {
+        for (size_t k = m_partition_offsets[first]; k < m_partition_offsets[last]; k++) {
+            dispatch(*m_partitioned_commands[k]->header, m_partitioned_commands[k]->payload);
+        }
+    });
+}
+
+World::CoalesceSlot& World::coalesce_slot(Entity entity) {
+    uint32_t index = entity_index(entity);
+    if (index >= m_coalesce_slots.size()) {
+        m_coalesce_slots.resize(index + 1);
+    }
+
+    CoalesceSlot& slot = m_coalesce_slots[index];
+    if (slot.entity == NULL_ENTITY && !slot.parent) {
+        m_coalesce_touched.push_back(index);
+    }
+    return slot;
+}
+
+bool World::post(std::function<void()> fn) {
+    return m_posted.try_push(std::move(fn));
+}
+
+void World::set_command_priority(int priority) {
+    m_command_priority.store(priority, std::memory_order_relaxed);
+}
+
+CommandBuffer& World::thread_commands() {
+    ThreadCommands* thread = nullptr;
+    for (auto& [world_id, cached] : t_thread_commands) {
+        if (world_id == m_id) {
+            thread = cached;
+            break;
+        }
+    }
+
+    if (!thread) {
+        thread = &register_thread_commands();
+        t_thread_commands.emplace_back(m_id, thread);
+    }
+
+    CommandBuffer& commands = thread->buffers[thread->recording];
+    commands.set_priority(m_command_priority.load(std::memory_order_relaxed));
+
+    // Only the first record after the thread moves to another chunk or out
+    // of a parallel_for starts a new run
+    std::vector<std::pair<size_t, uint64_t>>& runs = thread->order_runs[thread->recording];
+    uint64_t order = m_job_system->order_key();
+    if (runs.empty() || runs.back().second != order) {
+        runs.emplace_back(commands.size(), order);
+    }
+    return commands;
+}
+
+World::ThreadCommands& World::register_thread_commands() {
+    auto thread = std::make_unique<ThreadCommands>();
+    ThreadCommands& ref = *thread;
+
+    std::lock_guard<std::mutex> lock(m_command_mutex);
+    m_thread_commands.push_back(std::move(thread));
+    return ref;
+}
+
+// Recomputes the world transform of every child whose own transform or whose
+// parent's transform was written this window. Parents come first in the depth
+// order, so a change reaches the whole subtree in one pass. The pass walks the
+// transform slots the hierarchy caches for the depth order, and is skipped
+// when no transform was stamped this window.
+void World::propagate_transforms() {
+    ComponentPool<TransformComponent>* transforms = pool<TransformComponent>();
+    if (transforms->last_changed_tick() < m_tick) {
+        return;
+    }
+
+    const std::vector<Hierarchy::SlotLink>& links = m_hierarchy->slot_order(transforms->version(), [transforms](Entity entity) {
+        return transforms->contains(entity) ? static_cast<uint32_t>(transforms->index_of(entity)) : Hierarchy::NO_SLOT;
+    });
+
+    for (const Hierarchy::SlotLink& link : links) {
+        if (transforms->changed_tick(link.slot) >= m_tick || transforms->changed_tick(link.parent_slot) >= m_tick) {
+            transforms->ref(link.slot).update_world(transforms->ref(link.parent_slot));
+            transforms->mark_changed(link.slot);
+        }
+    }
+}
+
+// Recomposes the world matrices of the transforms written this window in one
+// batched pass, instead of once per setter
+void World::update_transforms() {
+    transform_streams().update_matrices();
+}
+
+Signature World::signature(Entity entity) const {
+    uint32_t index = entity_index(entity);
+    if (!m_entity_pool->is_alive(entity) || index >= m_signatures.size()) {
+        return Signature();
+    }
+    return m_signatures[index];
+}
+
+void World::instantiate(const Prefab& prefab, size_t count, std::vector<Entity>& out) {
+    instantiate_prefab(prefab, count, {}, out);
+}
+
+void World::instantiate(const Prefab& prefab, const std::vector<Transform>& transforms, std::vector<Entity>& out) {
+    instantiate_prefab(prefab, transforms.size(), transforms, out);
+}
+
+void World::instantiate_prefab(const Prefab& prefab, size_t count, std::vector<Transform> transforms, std::vector<Entity>& out) {
+    size_t first = out.size();
+    m_entity_pool->create(count, out);
+
+    std::vector<Entity> created(out.begin() + first, out.end());
+    submit([this, prefab, created = std::move(created), transforms = std::move(transforms)] {
+        m_entity_sparse_set->insert(created.data(), created.size());
+
+        uint32_t transform_id = TypeId::of<TransformComponent>();
+        bool has_transform = false;
+        for (const Prefab::Entry& entry : prefab.entries()) {
+            entry.insert(pool(entry.type_id, entry.type_name, entry.create_pool), entry.value.get(), created.data(), created.size());
+            set_signature_bits(created.data(), created.size(), entry.type_id, true);
+            has_transform |= entry.type_id == transform_id;
+        }
+
+        if (!transforms.empty() && !has_transform) {
+            pool<TransformComponent>()->insert(created.data(), created.size(), TransformComponent());
+            set_signature_bits(created.data(), created.size(), transform_id, true);
+        }
+
+        // The inserted transforms are the identity, write the values given in their place
+        const Transform* shared = prefab.transform();
+        if (transforms.empty() && !shared) {
+            return;
+        }
+
+        // New entities have no parent, their local space is world space
+        for (size_t i = 0; i < created.size(); i++) {
+            find_transform(created[i]).set_root(transforms.empty() ? *shared : transforms[i]);
+        }
+    });
+}
+
+ModelComponent World::make_model(const std::string& mesh_path, const std::string& material_id) {
+    ModelComponent model;
+    model.mesh = m_mesh_manager->load(mesh_path);
+    model.material = m_material_manager->load(material_id);
+    return model;
+}
+
+IComponentPool& World::pool(uint32_t type_id, const char* type_name, std::unique_ptr<IComponentPool> (*create)()) {
+    // Every component needs a signature bit
+    signature_bit(type_id, type_name);
+
+    if (!m_pools[type_id]) {
+        // Another thread may be reading m_pools, see the Component Interface
+        if (JobSystem::in_job()) {
+            std::cerr << "Component type " << type_name << " is used for the first time inside a "
+                      << "parallel loop. Register it before the loop starts." << std::endl;
+            std::abort();
+        }
+
+        m_pools[type_id] = create();
+        m_pools[type_id]->set_tick(m_tick);
+    }
+
+    return *m_pools[type_id];
+}
+
+void World::group_conflict(const char* group_name) {
+    std::cerr << "Cannot create group " << group_name << ", one of its pools is already owned by "
+              << "another group. Ask for a group with the same component types in the same order "
+              << "as the first call." << std::endl;
+    std::abort();
+}
+
+void World::sort_conflict(const char* type_name) {
+    std::cerr << "Cannot sort the pool of " << type_name << ", it is owned by a group. Sort the "
+              << "group instead." << std::endl;
+    std::abort();
+}
+
+void World::set_signature_bits(const Entity* entities, size_t count, uint32_t type_id, bool value) {
+    size_t bit = signature_bit(type_id);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t index = entity_index(entities[i]);
+        if (index >= m_signatures.size()) {
+            m_signatures.resize(index + 1);
+        }
+        m_signatures[index].set(bit, value);
     }
 }
 
 void World::add_component(Entity entity, ComponentType component_type) {
     switch (component_type) {
         case ComponentType::Transform:
-            m_command_queue->submit([this, entity] {
-                m_transform_component_pool->add(entity, std::make_unique<TransformComponent>());
-            });
+            add<TransformComponent>(entity);
             break;
         case ComponentType::Camera:
-            m_command_queue->submit([this, entity] {
-                m_camera_component_pool->add(entity, std::make_unique<CameraComponent>());
-            });
+            add<CameraComponent>(entity);
             break;
         case ComponentType::Model:
-            m_command_queue->submit([this, entity] {
-                m_model_component_pool->add(entity, std::make_unique<ModelComponent>());
-            });
+            add<ModelComponent>(entity);
             break;
     }
 }
@@ -59,79 +524,51 @@ Entity World::get_active_camera() const {
 }
 
 Mat4 World::get_camera_view_matrix(Entity camera) {
-    CameraComponent* camera_comp = m_camera_component_pool->get(camera);
-    TransformComponent* transform_comp = m_transform_component_pool->get(camera);
+    const CameraComponent* camera_comp = get<const CameraComponent>(camera);
+    TransformRef transform_comp = find_transform(camera);
 
     return !camera_comp || !transform_comp ? Mat4(1.0f) :
     camera_comp->get_view_matrix(
-        transform_comp->get_position(),
-        transform_comp->forward(),
-        transform_comp->up());
+        transform_comp.get_position(),
+        transform_comp.forward(),
+        transform_comp.up());
 }
 
 Mat4 World::get_camera_proj_matrix(Entity camera) {
-    CameraComponent* camera_comp = m_camera_component_pool->get(camera);
+    const CameraComponent* camera_comp = get<const CameraComponent>(camera);
 
     return !camera_comp ? Mat4(1.0f) : camera_comp->get_projection_matrix();
 }
 
 bgfx::ViewId World::get_gamera_proj_view_id(Entity camera) {
-    CameraComponent* camera_comp = m_camera_component_pool->get(camera);
+    const CameraComponent* camera_comp = get<const CameraComponent>(camera);
 
     return !camera_comp ? 0 : camera_comp->view_id;
 }
 
 uint16_t World::get_camera_clear_flags(Entity camera) {
-    CameraComponent* camera_comp = m_camera_component_pool->get(camera);
+    const CameraComponent* camera_comp = get<const CameraComponent>(camera);
 
     return !camera_comp ? 0 : camera_comp->clear_flags;
 }
 
 void World::set_active_camera(Entity entity) {
-    m_command_queue->submit([this, entity] {
-        m_active_camera = entity;
-    });
+    submit(CommandOp::SetActiveCamera, entity);
 }
 // =============================================================== //
 
 
 // ======================= Model Interface ======================= //
 void World::load_mesh(Entity entity, const std::string &file_path) {
-    m_command_queue->submit([this, entity, file_path] {
-        ModelComponent* model_comp = m_model_component_pool->get(entity);
-
-        if (!model_comp) {
-            std::cerr << "Entity does not contain a model component." << std::endl;
-            return;
-        }
-        model_comp->mesh = m_mesh_manager->load(file_path);
-    });
+    submit(CommandOp::LoadMesh, entity, std::string_view(file_path));
 }
 
 void World::load_material(Entity entity, const std::string &material_id) {
-    m_command_queue->submit([this, entity, material_id] {
-        ModelComponent* model_comp = m_model_component_pool->get(entity);
-
-        if (!model_comp) {
-            std::cerr << "Entity does not contain a model component." << std::endl;
-            return;
-        }
-
-        model_comp->material = m_material_manager->load(material_id);
-    });
+    submit(CommandOp::LoadMaterial, entity, std::string_view(material_id));
 }
 
 void World::set_backface_culling(Entity entity, bool enabled) {
-    m_command_queue->submit([this, entity, enabled] {
-        ModelComponent* model_comp = m_model_component_pool->get(entity);
-
-        if (!model_comp) {
-            std::cerr << "Entity does not contain a model component." << std::endl;
-            return;
-        }
-
-        model_comp->material->set_backface_culling(enabled);
-    });
+    submit(CommandOp::SetBackfaceCulling, entity, enabled);
 }
 // =============================================================== //
 
@@ -177,102 +614,251 @@ void World::set_input_manager_window(const std::shared_ptr<Window> &window) {
 
 // ====================== Transform Interface ==================== //
 Vec3 World::get_forward(Entity entity) {
-    TransformComponent* transform_comp = m_transform_component_pool->get(entity);
+    TransformRef transform_comp = find_transform(entity);
 
     if (!transform_comp) {
         std::cerr << "Entity does not contain a transform component." << std::endl;
         return Vec3(0.0f, 0.0f, 0.0f);
     }
 
-    return transform_comp->forward();
+    return transform_comp.forward();
 }
 
 Vec3 World::get_right(Entity entity) {
-    TransformComponent* transform_comp = m_transform_component_pool->get(entity);
+    TransformRef transform_comp = find_transform(entity);
 
     if (!transform_comp) {
         std::cerr << "Entity does not contain a transform component." << std::endl;
         return Vec3(0.0f, 0.0f, 0.0f);
     }
 
-    return transform_comp->right();
+    return transform_comp.right();
 }
 
 Vec3 World::get_up(Entity entity) {
-    TransformComponent* transform_comp = m_transform_component_pool->get(entity);
+    TransformRef transform_comp = find_transform(entity);
 
     if (!transform_comp) {
         std::cerr << "Entity does not contain a transform component." << std::endl;
         return Vec3(0.0f, 0.0f, 0.0f);
     }
 
-    return transform_comp->up();
+    return transform_comp.up();
 }
 
 Vec3 World::get_position(Entity entity) {
-    TransformComponent* transform_comp = m_transform_component_pool->get(entity);
+    TransformRef transform_comp = find_transform(entity);
 
     if (!transform_comp) {
         std::cerr << "Entity does not contain a transform component." << std::endl;
         return Vec3(0.0f, 0.0f, 0.0f);
     }
 
-    return transform_comp->get_position();
+    return transform_comp.get_position();
 }
 
 void World::set_position(Entity entity, Vec3 pos) {
-    m_command_queue->submit([this, entity, pos] {
-        TransformComponent* transform_comp = m_transform_component_pool->get(entity);
+    submit(CommandOp::SetPosition, entity, pos);
+}
 
-        if (!transform_comp) {
-            std::cerr << "Entity does not contain a transform component." << std::endl;
-            return;
-        }
+void World::set_rotation(Entity entity, Vec3 angle_rot) {
+    submit(CommandOp::SetRotation, entity, Quat(glm::radians(angle_rot)));
+}
 
-        transform_comp->set_position(pos);
-    });
+void World::set_rotation(Entity entity, Quat rot) {
+    submit(CommandOp::SetRotation, entity, rot);
 }
 
-void World::set_rotation(Entity entity, Vec3 angle_rot) {
-    m_command_queue->submit([this, entity, angle_rot] {
-        TransformComponent* transform_comp = m_transform_component_pool->get(entity);
+void World::rotate(Entity entity, Vec3 axis, float angle_rad) {
+    submit(CommandOp::Rotate, entity, RotateCommand{ axis, angle_rad });
+}
 
-        if (!transform_comp) {
-            std::cerr << "Entity does not contain a transform component." << std::endl;
-            return;
-        }
+void World::set_scale(Entity entity, Vec3 scale) {
+    submit(CommandOp::SetScale, entity, scale);
+}
+// =============================================================== //
 
-        Quat rot(glm::radians(angle_rot));
 
-        transform_comp->set_rotation(rot);
-    });
+// ====================== Hierarchy Interface ==================== //
+void World::set_parent(Entity child, Entity parent) {
+    submit(CommandOp::SetParent, child, parent);
 }
 
-void World::set_rotation(Entity entity, Quat rot) {
-    m_command_queue->submit([this, entity, rot] {
-        TransformComponent* transform_comp = m_transform_component_pool->get(entity);
+Entity World::get_parent(Entity entity) const {
+    return m_hierarchy->parent(entity);
+}
 
-        if (!transform_comp) {
-            std::cerr << "Entity does not contain a transform component." << std::endl;
-            return;
-        }
+Entity World::get_first_child(Entity entity) const {
+    return m_hierarchy->first_child(entity);
+}
 
-        transform_comp->set_rotation(rot);
-    });
+Entity World::get_next_sibling(Entity entity) const {
+    return m_hierarchy->next_sibling(entity);
 }
 
-void World::rotate(Entity entity, Vec3 axis, float angle_rad) {
-    m_command_queue->submit([this, entity, axis, angle_rad] {
-        TransformComponent* transform_comp = m_transform_component_pool->get(entity);
+const std::vector<Entity>& World::get_entities() const {
+    return m_entity_sparse_set->entities();
+}
 
-        if (!transform_comp) {
-            std::cerr << "Entity does not contain a transform component." << std::endl;
-            return;
-        }
+TransformRef World::transform(Entity entity) {
+    ComponentPool<TransformComponent>* transforms = find_pool<TransformComponent>();
+    if (!transforms || !transforms->get(entity)) {
+        return TransformRef();
+    }
+    return transforms->ref(transforms->index_of(entity));
+}
 
-        transform_comp->rotate(axis, angle_rad);
-    });
+TransformStreams& World::transform_streams() {
+    return pool<TransformComponent>()->columns();
+}
+
+// Rederives the local transform from a world space write, so propagation keeps it
+void World::sync_local_transform(Entity entity, TransformRef transform) {
+    if (TransformRef parent = find_transform(m_hierarchy->parent(entity))) {
+        transform.update_local(parent);
+    } else {
+        transform.set_local_position(transform.get_position());
+        transform.set_local_rotation(transform.get_rotation());
+        transform.set_local_scale(transform.get_scale());
+    }
 }
 // =============================================================== //
 
 
+// ======================= Command Execution ===================== //
+void World::dispatch(const CommandHeader& header, const void* payload) {
+    Entity entity = header.entity;
+
+    switch (header.op) {
+        case CommandOp::CreateEntities:
+            m_entity_sparse_set->insert(static_cast<const Entity*>(payload), header.payload_size / sizeof(Entity));
+            break;
+        case CommandOp::DestroyEntity:
+            apply_destroy_entity(entity);
+            break;
+        case CommandOp::SetActiveCamera:
+            m_active_camera = entity;
+            break;
+        case CommandOp::LoadMesh:
+            if (ModelComponent* model_comp = patch_model(entity)) {
+                model_comp->mesh = m_mesh_manager->load(std::string(static_cast<const char*>(payload), header.payload_size));
+            }
+            break;
+        case CommandOp::LoadMaterial:
+            if (ModelComponent* model_comp = patch_model(entity)) {
+                model_comp->material = m_material_manager->load(std::string(static_cast<const char*>(payload), header.payload_size));
+            }
+            break;
+        case CommandOp::SetBackfaceCulling:
+            if (ModelComponent* model_comp = patch_model(entity)) {
+                model_comp->material->set_backface_culling(payload_as<bool>(payload));
+            }
+            break;
+        case CommandOp::SetPosition:
+            if (TransformRef transform_comp = patch_transform(entity)) {
+                transform_comp.set_position(payload_as<Vec3>(payload));
+                sync_local_transform(entity, transform_comp);
+            }
+            break;
+        case CommandOp::SetRotation:
+            if (TransformRef transform_comp = patch_transform(entity)) {
+                transform_comp.set_rotation(payload_as<Quat>(payload));
+                sync_local_transform(entity, transform_comp);
+            }
+            break;
+        case CommandOp::SetScale:
+            if (TransformRef transform_comp = patch_transform(entity)) {
+                transform_comp.set_scale(payload_as<Vec3>(payload));
+                sync_local_transform(entity, transform_comp);
+            }
+            break;
+        case CommandOp::Rotate:
+            if (TransformRef transform_comp = patch_transform(entity)) {
+                RotateCommand rotate = payload_as<RotateCommand>(payload);
+                transform_comp.rotate(rotate.axis, rotate.angle_rad);
+                sync_local_transform(entity, transform_comp);
+            }
+            break;
+        case CommandOp::SetParent:
+            apply_set_parent(entity, payload_as<Entity>(payload));
+            break;
+        case CommandOp::Invoke:
+            break; // Run by the command buffer itself
+    }
+}
+
+void World::apply_destroy_entity(Entity entity) {
+    if (!m_entity_pool->is_alive(entity)) {
+        return;
+    }
+
+    for (auto& pool : m_pools) {
+        if (pool) {
+            pool->remove(entity);
+        }
+    }
+
+    if (entity_index(entity) < m_signatures.size()) {
+        m_signatures[entity_index(entity)].reset();
+    }
+
+    for (auto& tags : m_tag_sets) {
+        if (tags) {
+            tags->reset(entity_index(entity));
+        }
+    }
+
+    m_hierarchy->remove(entity);
+
+    if (m_entity_sparse_set->contains(entity)) {
+        m_entity_sparse_set->erase(entity);
+    }
+
+    if (m_active_camera == entity) {
+        m_active_camera = NULL_ENTITY;
+    }
+
+    // Bumps the slot's generation, every handle to this entity is now stale
+    m_entity_pool->destroy(entity);
+}
+
+void World::apply_set_parent(Entity child, Entity parent) {
+    if (!m_entity_pool->is_alive(child) || (parent != NULL_ENTITY && !m_entity_pool->is_alive(parent))) {
+        return;
+    }
+
+    if (!m_hierarchy->set_parent(child, parent)) {
+        std::cerr << "An entity cannot be parented to itself or its descendants." << std::endl;
+        return;
+    }
+
+    if (TransformRef transform_comp = find_transform(child)) {
+        sync_local_transform(child, transform_comp);
+    }
+}
+
+TransformRef World::find_transform(Entity entity) {
+    ComponentPool<TransformComponent>* transforms = pool<TransformComponent>();
+    if (!transforms->contains(entity)) {
+        return TransformRef();
+    }
+    return transforms->ref(transforms->index_of(entity));
+}
+
+TransformRef World::patch_transform(Entity entity) {
+    ComponentPool<TransformComponent>* transforms = pool<TransformComponent>();
+    if (!transforms->patch(entity)) {
+        std::cerr << "Entity does not contain a transform component." << std::endl;
+        return TransformRef();
+    }
+    return transforms->ref(transforms->index_of(entity));
+}
+
+ModelComponent* World::patch_model(Entity entity) {
+    ModelComponent* model_comp = pool<ModelComponent>()->patch(entity);
+    if (!model_comp) {
+        std::cerr << "Entity does not contain a model component." << std::endl;
+    }
+    return model_comp;
+}
+// =============================================================== //
@@ -1,15 +1,30 @@
 #ifndef GAME_WORLD_H
 #define GAME_WORLD_H
 
+#include <array>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <bgfx/bgfx.h>
 #include <string>
+#include <typeinfo>
 
 #include "ComponentPool.h"
-#include "CommandQueue.h"
+#include "CommandBuffer.h"
+#include "MpscQueue.h"
 #include "EntitySparseSet.h"
 #include "Types.h"
-#include "View2.h"
+#include "View.h"
+#include "Query.h"
+#include "Group.h"
+#include "TagSet.h"
+#include "Signature.h"
+#include "Prefab.h"
+#include "Hierarchy.h"
+#include "JobSystem.h"
+#include "TypeId.h"
 #include "EntityPool.h"
 #include "InputManager.h"
 #include "MeshManager.h"
@@ -22,16 +37,241 @@
 #include <components/ModelComponent.hpp>
 #include <components/CameraComponent.hpp>
 
-inline size_t MAX_ENTITIES = 10000;
-
 class World {
 public:
     World();
 
     // =================== General World Interface =================== //
     Entity create_entity();
+    void create_entities(size_t count, std::vector<Entity>& out);
+    void destroy_entity(Entity entity);
+    bool is_alive(Entity entity) const;
+
+    // Runs the commands recorded by every thread since the last call. No other
+    // thread may record while this runs. Records are merged by the priority of
+    // the system that recorded them, then by JobSystem::order_key() when they
+    // were recorded, then by the order their threads first recorded, then in
+    // the order each thread recorded them. Commands recorded from a par_each
+    // therefore run as a serial loop would have recorded them, whichever thread
+    // ran each chunk. Only two threads recording outside of any parallel_for at
+    // the same time are ordered by the schedule. Many transform writes between
+    // two barriers (SetParent, DestroyEntity, Invoke) are spread over the job
+    // system, with every hierarchy kept on one thread, which gives the same
+    // result as running them in order.
     void execute_commands();
+
+    // Stamped on the commands recorded from now on, by any thread. Systems sets
+    // it to each system's priority while firing.
+    void set_command_priority(int priority);
+
+    // Transform writes dropped so far because a later write to the same entity
+    // and field replaced them within the same sync
+    size_t coalesced_command_count() const;
+
+    // For threads outside the frame (asset loaders, physics, network) that can
+    // not keep to the rule above. fn runs on the thread that calls
+    // execute_commands(), at the start of the next call and before the recorded
+    // commands, so it may touch the world directly. Never blocks, returns false
+    // if the queue is full.
+    bool post(std::function<void()> fn);
+
     void add_component(Entity entity, ComponentType component_type);
+
+    // Bit TypeId::of<T>() is set for every component T the entity has
+    Signature signature(Entity entity) const;
+
+    template<typename... Ts>
+    bool has_all(Entity entity) const {
+        Signature mask = signature_of<Ts...>();
+        return (signature(entity) & mask) == mask;
+    }
+    // =============================================================== //
+
+
+    // ====================== Component Interface ==================== //
+    // Any type can be a component, its pool is created on first use and
+    // looked up by TypeId in a flat array. Only the thread that owns the world
+    // creates pools: get(), has() and patch() never do, and view(), query(),
+    // group() and register_component() must not be called inside a parallel
+    // loop for a type that has no pool yet.
+    template<typename T>
+    void register_component() {
+        pool<T>();
+    }
+
+    template<typename T, typename... Args>
+    void add(Entity entity, Args&&... args) {
+        submit([this, entity, args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            std::apply([this, entity](auto&... a) {
+                pool<T>()->emplace(entity, std::move(a)...);
+            }, args);
+            set_signature_bits(&entity, 1, TypeId::of<T>(), true);
+        });
+    }
+
+    // Bulk add, components[i] goes to entities[i]. Queues a single command and
+    // grows the pool once, use this over add<T>() when spawning many entities.
+    template<typename T>
+    void add_components(const std::vector<Entity>& entities, std::vector<T> components) {
+        assert(entities.size() == components.size() && "Every entity needs one component!");
+        submit([this, entities, components = std::move(components)] {
+            pool<T>()->insert(entities.data(), entities.size(), components.data());
+            set_signature_bits(entities.data(), entities.size(), TypeId::of<T>(), true);
+        });
+    }
+
+    // Bulk add of one value to every entity
+    template<typename T>
+    void add_components(const std::vector<Entity>& entities, const T& value = T()) {
+        submit([this, entities, value] {
+            pool<T>()->insert(entities.data(), entities.size(), value);
+            set_signature_bits(entities.data(), entities.size(), TypeId::of<T>(), true);
+        });
+    }
+
+    template<typename T>
+    void remove(Entity entity) {
+        submit([this, entity] {
+            if (pool<T>()->contains(entity)) {
+                pool<T>()->remove(entity);
+                set_signature_bits(&entity, 1, TypeId::of<T>(), false);
+            }
+        });
+    }
+
+    // get<T>() marks the component as changed for change-filtered views,
+    // get<const T>() reads it without doing so. Components kept in columns have
+    // their own accessor, e.g. transform().
+    template<typename T>
+    T* get(Entity entity) {
+        using Component = std::remove_const_t<T>;
+        static_assert(std::is_same_v<component_columns_t<Component>, NoColumns>, "T is kept in columns, use its accessor");
+        ComponentPool<Component>* components = find_pool<Component>();
+        if (!components) {
+            return nullptr;
+        }
+
+        if constexpr (std::is_const_v<T>) {
+            return std::as_const(*components).get(entity);
+        } else {
+            return components->get(entity);
+        }
+    }
+
+    template<typename T>
+    bool has(Entity entity) {
+        ComponentPool<T>* components = find_pool<T>();
+        return components && components->contains(entity);
+    }
+    // =============================================================== //
+
+
+    // ======================== Prefab Interface ===================== //
+    // Creates count copies of prefab with a single command, appending each
+    // component to its pool in bulk. Instances start at the prefab's
+    // set_transform(), if it has one.
+    void instantiate(const Prefab& prefab, size_t count, std::vector<Entity>& out);
+
+    // One instance per transform, each placed at its own transform in place of
+    // the prefab's. The instances get a TransformComponent even if the prefab
+    // has none.
+    void instantiate(const Prefab& prefab, const std::vector<Transform>& transforms, std::vector<Entity>& out);
+
+    // Loads the mesh and material immediately, so a prefab resolves them once
+    ModelComponent make_model(const std::string& mesh_path, const std::string& material_id);
+    // =============================================================== //
+
+
+    // ====================== Resource Interface ===================== //
+    // One instance per type of world-wide data (render settings, frame stats,
+    // ...), stored by ResourceTypeId. Unlike components these are not queued,
+    // they are created, replaced and read immediately.
+    template<typename T, typename... Args>
+    T& emplace_resource(Args&&... args) {
+        uint32_t id = ResourceTypeId::of<T>();
+        if (id >= m_resources.size()) {
+            m_resources.resize(id + 1);
+        }
+
+        auto created = std::make_shared<T>(std::forward<Args>(args)...);
+        T& ref = *created;
+        m_resources[id] = std::move(created);
+        return ref;
+    }
+
+    // Default constructs the resource on first access
+    template<typename T>
+    T& resource() {
+        if (T* existing = try_resource<T>()) {
+            return *existing;
+        }
+        return emplace_resource<T>();
+    }
+
+    template<typename T>
+    T* try_resource() {
+        uint32_t id = ResourceTypeId::of<T>();
+        return id < m_resources.size() ? static_cast<T*>(m_resources[id].get()) : nullptr;
+    }
+
+    template<typename T>
+    void remove_resource() {
+        uint32_t id = ResourceTypeId::of<T>();
+        if (id < m_resources.size()) {
+            m_resources[id].reset();
+        }
+    }
+    // =============================================================== //
+
+
+    // ========================= Tag Interface ======================= //
+    // Tags are empty types stored as one bit per entity instead of in a pool,
+    // e.g. world.add_tag<Selected>(entity).
+    template<typename T>
+    void add_tag(Entity entity) {
+        submit([this, entity] {
+            if (m_entity_pool->is_alive(entity)) {
+                tag_set<T>().set(entity_index(entity));
+            }
+        });
+    }
+
+    template<typename T>
+    void remove_tag(Entity entity) {
+        submit([this, entity] {
+            if (m_entity_pool->is_alive(entity)) {
+                tag_set<T>().reset(entity_index(entity));
+            }
+        });
+    }
+
+    template<typename T>
+    bool has_tag(Entity entity) {
+        const TagSet* set = find_tag_set<T>();
+        return set && m_entity_pool->is_alive(entity) && set->test(entity_index(entity));
+    }
+
+    // Calls fn(Entity) for every entity tagged with T
+    template<typename T, typename Fn>
+    void each_tagged(Fn&& fn) {
+        if (const TagSet* set = find_tag_set<T>()) {
+            set->each([this, &fn](uint32_t index) {
+                fn(m_entity_pool->handle(index));
+            });
+        }
+    }
+
+    template<typename T>
+    size_t tag_count() {
+        const TagSet* set = find_tag_set<T>();
+        return set ? set->count() : 0;
+    }
+
+    // For view filters, e.g. world.view<A>().with_tag(world.tags<Visible>())
+    template<typename T>
+    const TagSet& tags() {
+        return tag_set<T>();
+    }
     // =============================================================== //
 
 
@@ -75,40 +315,256 @@ public:
     void set_rotation(Entity entity, Vec3 angle_rot);
     void set_rotation(Entity entity, Quat rot);
     void rotate(Entity entity, Vec3 axis, float angle_rad);
-    void set_scale();
+    void set_scale(Entity entity, Vec3 scale);
+
+    // Direct access to the entity's transform, empty if it has none. Marks it
+    // as changed like get<T>(). Unlike set_position() and friends the writes
+    // are not queued. Children have their world values recomputed from the
+    // local ones at the next execute_commands(), so write those for them.
+    TransformRef transform(Entity entity);
+    // =============================================================== //
+
+
+    // ====================== Hierarchy Interface ==================== //
+    // Children follow their parent's transform. Reparenting keeps the child's
+    // world transform, and parent NULL_ENTITY makes the child a root again.
+    void set_parent(Entity child, Entity parent);
+    Entity get_parent(Entity entity) const;
+    Entity get_first_child(Entity entity) const;
+    Entity get_next_sibling(Entity entity) const;
+    const std::vector<Entity>& get_entities() const;
     // =============================================================== //
 
-    template<typename A, typename B>
-    View2<A,B> view() {
-        return View2<A, B>(*pool<A>(), *pool<B>());
+    // Same as get<T>(), for call sites that want to say they write
+    template<typename T>
+    T* patch(Entity entity) {
+        ComponentPool<T>* components = find_pool<T>();
+        return components ? components->patch(entity) : nullptr;
+    }
+
+    // view<A, Optional<B>>(exclude<C>) yields (Entity, A&, B*) for entities with A and without C.
+    // view<const A>() yields const A& and does not mark A as changed, see BasicView.
+    template<typename... Ts, typename... Es>
+    BasicView<Exclude<Es...>, Ts...> view(Exclude<Es...> = {}) {
+        return BasicView<Exclude<Es...>, Ts...>(
+            m_job_system.get(),
+            &m_signatures,
+            *pool<typename ViewTerm<Ts>::Component>()...,
+            *pool<Es>()...);
+    }
+
+    // Cached view<Ts...>(exclude<Es...>), one instance per signature shared by
+    // every caller. Use it for joins walked every frame on mostly static data.
+    template<typename... Ts, typename... Es>
+    BasicQuery<Exclude<Es...>, Ts...>& query(Exclude<Es...> = {}) {
+        using QueryType = BasicQuery<Exclude<Es...>, Ts...>;
+        uint32_t id = QueryTypeId::of<QueryType>();
+        if (id >= m_queries.size()) {
+            m_queries.resize(id + 1);
+        }
+
+        if (!m_queries[id]) {
+            m_queries[id] = std::make_shared<QueryType>(
+                m_job_system.get(),
+                &m_signatures,
+                *pool<typename ViewTerm<Ts>::Component>()...,
+                *pool<Es>()...);
+        }
+
+        return *static_cast<QueryType*>(m_queries[id].get());
+    }
+
+    // Reorders the pool of T by comp, e.g. so that view<T>() walks it in a
+    // spatial order. comp is called with what view<const T>() yields, so
+    // transforms are compared as const TransformRef and can be sorted by
+    // position. Runs immediately and moves components between slots, so not
+    // while T is being iterated. A pool owned by a group is ordered by the
+    // group, sort the group instead: asking for it here is an error.
+    template<typename T, typename Compare>
+    void sort(Compare comp) {
+        ComponentPool<T>* components = pool<T>();
+        if (components->group()) {
+            sort_conflict(typeid(T).name());
+        }
+        components->sort(comp);
+    }
+
+    // Owning group over Ts, created on first use. Each pool can belong to one
+    // group only, and the group is looked up by its exact type: group<B, A>()
+    // after group<A, B>() is an error, not the same group.
+    template<typename... Ts>
+    Group<Ts...>& group() {
+        using First = std::tuple_element_t<0, std::tuple<Ts...>>;
+        if (IGroup* owner = pool<First>()->group()) {
+            if (auto* existing = dynamic_cast<Group<Ts...>*>(owner)) {
+                return *existing;
+            }
+            group_conflict(typeid(Group<Ts...>).name());
+        }
+
+        if ((pool<Ts>()->group() || ...)) {
+            group_conflict(typeid(Group<Ts...>).name());
+        }
+
+        auto group = std::make_unique<Group<Ts...>>(*pool<Ts>()...);
+        Group<Ts...>& ref = *group;
+        m_groups.push_back(std::move(group));
+        return ref;
     }
 
 private:
     Entity m_active_camera;
-    std::unique_ptr<CommandQueue> m_command_queue;
+    uint32_t m_tick = 1;
+
+    // Each recording thread gets its own pair of buffers, so recording never
+    // takes a lock. execute_commands() swaps every pair and runs the executing
+    // side, commands recorded while those run go to the recording side.
+    struct ThreadCommands {
+        CommandBuffer buffers[2];
+        // (first record, JobSystem::order_key()) where the order key changes, per buffer
+        std::vector<std::pair<size_t, uint64_t>> order_runs[2];
+        size_t recording = 0; // Index into buffers
+    };
+
+    // Sort key of one record while the thread buffers are merged
+    struct CommandRef {
+        int32_t priority;
+        uint64_t order;
+        const CommandHeader* header;
+        void* payload;
+    };
+
+    uint64_t m_id;                     // Tells worlds apart in the per-thread buffer cache
+    std::atomic<int> m_command_priority{0};
+    std::mutex m_command_mutex;        // Guards m_thread_commands, taken once per new thread
+    std::vector<std::unique_ptr<ThreadCommands>> m_thread_commands; // In registration order
+    std::vector<CommandRef> m_merged_commands;
+
+    // Per entity index while coalesce_commands() walks the merged commands
+    struct CoalesceSlot {
+        Entity entity = NULL_ENTITY;
+        uint8_t fields = 0;  // Fields a later command overwrites
+        bool parent = false; // Gains a child this sync, so its writes are read
+    };
+
+    std::vector<CoalesceSlot> m_coalesce_slots;
+    std::vector<uint32_t> m_coalesce_touched;
+    size_t m_coalesced_commands = 0;
+
+    // Transform writes between two barriers are applied in parallel once there
+    // are at least this many of them
+    static constexpr size_t PARALLEL_WRITE_THRESHOLD = 2048;
+    std::vector<size_t> m_partition_offsets;
+    std::vector<size_t> m_partition_cursor;
+    std::vector<uint32_t> m_partition_of;
+    std::vector<const CommandRef*> m_partitioned_commands;
+
+    static constexpr size_t POSTED_CAPACITY = 4096;
+    MpscQueue<std::function<void()>> m_posted{POSTED_CAPACITY};
+
+    // (world id, buffers) for every world the thread has recorded into
+    static thread_local std::vector<std::pair<uint64_t, ThreadCommands*>> t_thread_commands;
+    std::unique_ptr<JobSystem> m_job_system;
     std::unique_ptr<EntityPool> m_entity_pool;
     std::unique_ptr<EntitySparseSet> m_entity_sparse_set;
+    std::unique_ptr<Hierarchy> m_hierarchy;
 
     std::unique_ptr<InputManager> m_input_manager;
     std::unique_ptr<MeshManager> m_mesh_manager;
     std::unique_ptr<MaterialManager> m_material_manager;
 
 
-    std::unique_ptr<ComponentPool<TransformComponent>> m_transform_component_pool;
-    std::unique_ptr<ComponentPool<CameraComponent>> m_camera_component_pool;
-    std::unique_ptr<ComponentPool<ModelComponent>> m_model_component_pool;
+    // Indexed by TypeId, null for types that have not been used as a component yet.
+    // Fixed size so that creating a pool never moves the others under a reader.
+    std::array<std::unique_ptr<IComponentPool>, MAX_SIGNATURE_TYPES> m_pools;
+    std::vector<std::unique_ptr<IGroup>> m_groups;
 
-    template<typename C> ComponentPool<C>* pool();
-};
+    // Component signature of every entity, indexed by entity_index()
+    std::vector<Signature> m_signatures;
+
+    void set_signature_bits(const Entity* entities, size_t count, uint32_t type_id, bool value);
+
+    // Indexed by QueryTypeId, created on first use
+    std::vector<std::shared_ptr<void>> m_queries;
+
+    // Indexed by ResourceTypeId, null for types that are not a resource
+    std::vector<std::shared_ptr<void>> m_resources;
+
+    // Indexed by TagTypeId, null for types never used as a tag
+    std::vector<std::unique_ptr<TagSet>> m_tag_sets;
+
+    template<typename Fn>
+    void submit(Fn&& fn) {
+        thread_commands().push_invoke(std::forward<Fn>(fn));
+    }
+
+    template<typename... Payload>
+    void submit(CommandOp op, Payload&&... payload) {
+        thread_commands().push(op, std::forward<Payload>(payload)...);
+    }
+
+    // The calling thread's recording buffer, registered on first use
+    CommandBuffer& thread_commands();
+    ThreadCommands& register_thread_commands();
+
+    void coalesce_commands();
+    CoalesceSlot& coalesce_slot(Entity entity);
+    void apply_transform_writes(size_t begin, size_t end);
+    void dispatch(const CommandHeader& header, const void* payload);
+    void apply_destroy_entity(Entity entity);
+    void apply_set_parent(Entity child, Entity parent);
+    void instantiate_prefab(const Prefab& prefab, size_t count, std::vector<Transform> transforms, std::vector<Entity>& out);
+    TransformStreams& transform_streams();
+    TransformRef find_transform(Entity entity);
+    TransformRef patch_transform(Entity entity);
+    ModelComponent* patch_model(Entity entity);
+
+    void propagate_transforms();
+    void update_transforms();
+    void sync_local_transform(Entity entity, TransformRef transform);
 
-template<> inline ComponentPool<TransformComponent>* World::pool<TransformComponent>() {
-    return m_transform_component_pool.get();
-}
-template<> inline ComponentPool<CameraComponent>* World::pool<CameraComponent>() {
-    return m_camera_component_pool.get();
-}
-template<> inline ComponentPool<ModelComponent>* World::pool<ModelComponent>() {
-    return m_model_component_pool.get();
-}
+    template<typename T>
+    ComponentPool<T>* pool() {
+        return static_cast<ComponentPool<T>*>(&pool(TypeId::of<T>(), typeid(T).name(), []() -> std::unique_ptr<IComponentPool> {
+            return std::make_unique<ComponentPool<T>>();
+        }));
+    }
+
+    // Reports a group that would share a pool with an existing one and aborts
+    [[noreturn]] static void group_conflict(const char* group_name);
+
+    // Reports a sort of a pool that a group owns and aborts
+    [[noreturn]] static void sort_conflict(const char* type_name);
+
+    IComponentPool& pool(uint32_t type_id, const char* type_name, std::unique_ptr<IComponentPool> (*create)());
+
+    // Null if T has no pool yet, never creates one
+    template<typename T>
+    ComponentPool<T>* find_pool() {
+        uint32_t id = TypeId::of<T>();
+        return id < m_pools.size() ? static_cast<ComponentPool<T>*>(m_pools[id].get()) : nullptr;
+    }
+
+    template<typename T>
+    const TagSet* find_tag_set() const {
+        uint32_t id = TagTypeId::of<T>();
+        return id < m_tag_sets.size() ? m_tag_sets[id].get() : nullptr;
+    }
+
+    template<typename T>
+    TagSet& tag_set() {
+        static_assert(std::is_empty_v<T>, "Tags must be empty types");
+        uint32_t id = TagTypeId::of<T>();
+        if (id >= m_tag_sets.size()) {
+            m_tag_sets.resize(id + 1);
+        }
+
+        if (!m_tag_sets[id]) {
+            m_tag_sets[id] = std::make_unique<TagSet>();
+        }
+
+        return *m_tag_sets[id];
+    }
+};
 
 #endif //GAME_WORLD_H
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include "EntitiesPanel.h"
+#include <core/World.h>
 #include <imgui.h>
 
-EntitiesPanel::EntitiesPanel() {}
+EntitiesPanel::EntitiesPanel(const std::shared_ptr<World>& world)
+    :   m_world(world)
+{}
 
 void EntitiesPanel::render() {
     ImVec2 size = ImVec2(300, 400);
@@ -50,7 +53,30 @@ void EntitiesPanel::render_list_view() {
 }
 
 void EntitiesPanel::render_hierarchy_view() {
+    for (Entity entity : m_world->get_entities()) {
+        if (m_world->get_parent(entity) == NULL_ENTITY) {
+            render_hierarchy_node(entity);
+        }
+    }
+}
+
+void EntitiesPanel::render_hierarchy_node(Entity entity) {
+    Entity first_child = m_world->get_first_child(entity);
+
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_SpanAvailWidth;
+    if (first_child == NULL_ENTITY) {
+        flags |= ImGuiTreeNodeFlags_Leaf;
+    }
+
+    bool open = ImGui::TreeNodeEx(reinterpret_cast<void*>(static_cast<uintptr_t>(entity)), flags, "Entity %u", entity_index(entity));
+    if (!open) {
+        return;
+    }
 
+    for (Entity child = first_child; child != NULL_ENTITY; child = m_world->get_next_sibling(child)) {
+        render_hierarchy_node(child);
+    }
+    ImGui::TreePop();
 }
 
 
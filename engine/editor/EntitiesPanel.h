@@ -1,16 +1,23 @@
 #ifndef GAME_WORLDPANEL_H
 #define GAME_WORLDPANEL_H
 
+#include <memory>
+#include <core/Types.h>
+
+class World;
+
 class EntitiesPanel {
 public:
-    EntitiesPanel();
+    EntitiesPanel(const std::shared_ptr<World>& world);
 
     void render();
 private:
     bool m_show_hierarchy = false;
+    std::shared_ptr<World> m_world;
 
     void render_list_view();
     void render_hierarchy_view();
+    void render_hierarchy_node(Entity entity);
 };
 
 #endif //GAME_WORLDPANEL_H
\ No newline at end of file
@@ -13,7 +13,9 @@
 
 
 
-Editor::Editor() {}
+Editor::Editor(const std::shared_ptr<World>& world)
+    :   m_world(world)
+{}
 
 Editor::~Editor() {
     shutdown();
@@ -51,7 +53,7 @@ void Editor::init() {
 
     // Initialize editor components
     m_properties_panel = std::make_unique<PropertiesPanel>();
-    m_entities_panel = std::make_unique<EntitiesPanel>();
+    m_entities_panel = std::make_unique<EntitiesPanel>(m_world);
 
     std::cout << "Editor Initialized!" << std::endl;
 
@@ -4,13 +4,14 @@
 #include <memory>
 
 class Window;
+class World;
 
 class PropertiesPanel;
 class EntitiesPanel;
 
 class Editor {
 public:
-    Editor();
+    Editor(const std::shared_ptr<World>& world);
     ~Editor();
 
     void init();
@@ -24,6 +25,7 @@ private:
     std::unique_ptr<Window> m_window;
     std::unique_ptr<PropertiesPanel> m_properties_panel;
     std::unique_ptr<EntitiesPanel> m_entities_panel;
+    std::shared_ptr<World> m_world;
 };
 
 #endif //GAME_EDITOR_H
\ No newline at end of file
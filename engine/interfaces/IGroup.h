@@ -0,0 +1,16 @@
+#ifndef GAME_IGROUP_H
+#define GAME_IGROUP_H
+
+#include <core/Types.h>
+
+// Notified by the pools a group owns so it can keep them co-sorted
+class IGroup {
+public:
+    virtual ~IGroup() {}
+    virtual void on_add(Entity entity) = 0;
+    // A batch of entities was appended to the end of the pool in one go
+    virtual void on_append(const Entity* entities, size_t count) = 0;
+    virtual void on_remove(Entity entity) = 0;
+};
+
+#endif //GAME_IGROUP_H
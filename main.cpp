@@ -12,7 +12,7 @@
 int main() {
     auto world = std::make_shared<World>();
 
-    Editor editor;
+    Editor editor(world);
     App app(world);
 
     editor.init();
@@ -0,0 +1,17 @@
+#ifndef GAME_CHECK_H
+#define GAME_CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// Like assert(), but also checked in release builds. Every test is a plain
+// program that exits non-zero on the first failed check.
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            std::exit(1);                                                                  \
+        }                                                                                  \
+    } while (0)
+
+#endif //GAME_CHECK_H
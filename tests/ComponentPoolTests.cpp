@@ -0,0 +1,109 @@
+#include "Check.h"
+#include <core/ComponentPool.h>
+#include <core/Group.h>
+#include <utility>
+#include <vector>
+
+struct Position {
+    float x = 0.0f;
+};
+
+struct Velocity {
+    float x = 0.0f;
+};
+
+// Every entity maps to its own dense slot and back
+template<typename T>
+static void check_consistent(const ComponentPool<T>& pool) {
+    for (size_t i = 0; i < pool.size(); i++) {
+        Entity entity = pool.entities()[i];
+        CHECK(pool.contains(entity));
+        CHECK(pool.index_of(entity) == i);
+    }
+}
+
+static void insert_appends_new_entities() {
+    ComponentPool<Position> pool;
+    std::vector<Entity> entities = { make_entity(0, 0), make_entity(1, 0), make_entity(2, 0) };
+    std::vector<Position> values = { {1.0f}, {2.0f}, {3.0f} };
+    pool.insert(entities.data(), entities.size(), values.data());
+
+    CHECK(pool.size() == 3);
+    for (size_t i = 0; i < entities.size(); i++) {
+        CHECK(std::as_const(pool).get(entities[i])->x == values[i].x);
+    }
+    check_consistent(pool);
+}
+
+static void insert_with_repeated_entity_keeps_one_slot() {
+    ComponentPool<Position> pool;
+    Entity a = make_entity(0, 0);
+    Entity b = make_entity(1, 0);
+    std::vector<Entity> entities = { a, b, a };
+    std::vector<Position> values = { {1.0f}, {2.0f}, {3.0f} };
+    pool.insert(entities.data(), entities.size(), values.data());
+
+    CHECK(pool.size() == 2);
+    CHECK(std::as_const(pool).get(a)->x == 3.0f);
+    CHECK(std::as_const(pool).get(b)->x == 2.0f);
+    check_consistent(pool);
+
+    // The pool stays usable after the fallback
+    pool.remove(a);
+    CHECK(!pool.contains(a));
+    CHECK(pool.size() == 1);
+    check_consistent(pool);
+}
+
+static void insert_value_with_repeated_entity_keeps_one_slot() {
+    ComponentPool<Position> pool;
+    Entity a = make_entity(4, 0);
+    std::vector<Entity> entities = { a, a };
+    pool.insert(entities.data(), entities.size(), Position{5.0f});
+
+    CHECK(pool.size() == 1);
+    CHECK(std::as_const(pool).get(a)->x == 5.0f);
+    check_consistent(pool);
+}
+
+static void insert_with_existing_entity_overwrites_it() {
+    ComponentPool<Position> pool;
+    Entity a = make_entity(0, 0);
+    Entity b = make_entity(1, 0);
+    pool.add(a, Position{1.0f});
+
+    std::vector<Entity> entities = { b, a };
+    std::vector<Position> values = { {2.0f}, {3.0f} };
+    pool.insert(entities.data(), entities.size(), values.data());
+
+    CHECK(pool.size() == 2);
+    CHECK(std::as_const(pool).get(a)->x == 3.0f);
+    CHECK(std::as_const(pool).get(b)->x == 2.0f);
+    check_consistent(pool);
+}
+
+static void insert_with_repeated_entity_into_group() {
+    ComponentPool<Position> positions;
+    ComponentPool<Velocity> velocities;
+    Group<Position, Velocity> group(positions, velocities);
+
+    Entity a = make_entity(0, 0);
+    Entity b = make_entity(1, 0);
+    std::vector<Entity> entities = { a, b, b, a };
+    velocities.insert(entities.data(), entities.size(), Velocity{1.0f});
+    positions.insert(entities.data(), entities.size(), Position{2.0f});
+
+    CHECK(group.size() == 2);
+    CHECK(group.contains(a) && group.contains(b));
+    check_consistent(positions);
+    check_consistent(velocities);
+}
+
+int main() {
+    insert_appends_new_entities();
+    insert_with_repeated_entity_keeps_one_slot();
+    insert_value_with_repeated_entity_keeps_one_slot();
+    insert_with_existing_entity_overwrites_it();
+    insert_with_repeated_entity_into_group();
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "Check.h"
+#include <core/World.h>
+#include <cstdint>
+#include <vector>
+
+struct Health {
+    int value = 0;
+};
+
+// Spreads the low 10 bits of v so two zero bits follow each of them
+static uint32_t spread_bits(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// Z-order curve index of a point in a 1024^3 grid of unit cells
+static uint32_t morton_code(const Vec3& position) {
+    return spread_bits(static_cast<uint32_t>(position.x)) |
+           (spread_bits(static_cast<uint32_t>(position.y)) << 1) |
+           (spread_bits(static_cast<uint32_t>(position.z)) << 2);
+}
+
+static void sort_transforms_in_morton_order() {
+    World world;
+    std::vector<Entity> entities;
+    world.create_entities(512, entities);
+    world.add_components<TransformComponent>(entities);
+    world.execute_commands();
+
+    // An 8x8x8 grid, handed out in a scrambled order
+    std::vector<Vec3> positions(entities.size());
+    for (size_t i = 0; i < entities.size(); i++) {
+        size_t cell = (i * 167) % entities.size();
+        positions[i] = Vec3(float(cell % 8), float(cell / 8 % 8), float(cell / 64));
+        world.set_position(entities[i], positions[i]);
+    }
+    world.execute_commands();
+
+    world.sort<TransformComponent>([](const TransformRef& a, const TransformRef& b) {
+        return morton_code(a.get_position()) < morton_code(b.get_position());
+    });
+
+    // The view now walks the transforms in Morton order
+    uint32_t previous = 0;
+    size_t visited = 0;
+    for (auto [entity, transform] : world.view<const TransformComponent>()) {
+        uint32_t code = morton_code(transform.get_position());
+        CHECK(visited == 0 || previous < code);
+        previous = code;
+        ++visited;
+    }
+    CHECK(visited == entities.size());
+
+    // Every entity kept its own transform
+    for (size_t i = 0; i < entities.size(); i++) {
+        CHECK(world.get_position(entities[i]) == positions[i]);
+    }
+}
+
+static void sort_components_by_value() {
+    World world;
+    std::vector<Entity> entities;
+    world.create_entities(100, entities);
+
+    std::vector<Health> values;
+    for (size_t i = 0; i < entities.size(); i++) {
+        values.push_back(Health{ int((i * 37) % 100) });
+    }
+    world.add_components<Health>(entities, values);
+    world.execute_commands();
+
+    world.sort<Health>([](const Health& a, const Health& b) { return a.value < b.value; });
+
+    int expected = 0;
+    for (auto [entity, health] : world.view<const Health>()) {
+        CHECK(health.value == expected++);
+    }
+    for (size_t i = 0; i < entities.size(); i++) {
+        CHECK(world.get<const Health>(entities[i])->value == values[i].value);
+    }
+}
+
+static void sorted_children_follow_their_parents() {
+    World world;
+    std::vector<Entity> entities;
+    world.create_entities(64, entities);
+    world.add_components<TransformComponent>(entities);
+    world.execute_commands();
+
+    for (size_t i = 0; i < entities.size(); i++) {
+        world.set_position(entities[i], Vec3(float(63 - i), 0.0f, 0.0f));
+        if (i % 2) {
+            world.set_parent(entities[i], entities[i - 1]);
+        }
+    }
+    world.execute_commands();
+
+    world.sort<TransformComponent>([](const TransformRef& a, const TransformRef& b) {
+        return a.get_position().x < b.get_position().x;
+    });
+
+    for (size_t i = 0; i < entities.size(); i += 2) {
+        world.set_position(entities[i], Vec3(float(i), 5.0f, 0.0f));
+    }
+    world.execute_commands();
+
+    // Each child keeps its offset of -1 in x from its parent
+    for (size_t i = 1; i < entities.size(); i += 2) {
+        CHECK(world.get_position(entities[i]) == Vec3(float(i) - 2.0f, 5.0f, 0.0f));
+    }
+}
+
+int main() {
+    sort_transforms_in_morton_order();
+    sort_components_by_value();
+    sorted_children_follow_their_parents();
+    return 0;
+}